@@ -8,6 +8,9 @@ DEFINES += APP_VERSION=\\\"$$VERSION\\\"
 win32:LIBS += -lOpenGL32
 unix:LIBS += -lOpenGL
 
+# Use std::complex instead of the fast complex type in the kernel (reference output)
+strict_complex: DEFINES += NF_STRICT_COMPLEX
+
 CONFIG(release, debug|release) {
     OBJECTS_DIR = release/obj
     MOC_DIR = release/moc
@@ -37,7 +40,24 @@ SOURCES += \
     src/imageline.cpp \
     src/root.cpp \
     src/rooticon.cpp \
-    src/styler.cpp
+    src/styler.cpp \
+    src/recorder.cpp \
+    src/animation.cpp \
+    src/animator.cpp \
+    src/framewriter.cpp \
+    src/batch.cpp \
+    src/zoomvideo.cpp \
+    src/sweep.cpp \
+    src/largekernel.cpp \
+    src/speculator.cpp \
+    src/governor.cpp \
+    src/tuner.cpp \
+    src/calibrator.cpp \
+    src/symmetry.cpp \
+    src/basinmap.cpp \
+    src/certifier.cpp \
+    src/antialiaser.cpp \
+    src/exporter.cpp
 
 HEADERS += \
     src/fractalwidget.h \
@@ -51,7 +71,27 @@ HEADERS += \
     src/imageline.h \
     src/root.h \
     src/rooticon.h \
-    src/styler.h
+    src/styler.h \
+    src/recorder.h \
+    src/animation.h \
+    src/animator.h \
+    src/framewriter.h \
+    src/batch.h \
+    src/kernel.h \
+    src/zoomvideo.h \
+    src/sweep.h \
+    src/largekernel.h \
+    src/fastcomplex.h \
+    src/floatkernel.h \
+    src/speculator.h \
+    src/governor.h \
+    src/tuner.h \
+    src/calibrator.h \
+    src/symmetry.h \
+    src/basinmap.h \
+    src/certifier.h \
+    src/antialiaser.h \
+    src/exporter.h
 
 FORMS += \
     src/settingswidget.ui
@@ -0,0 +1,197 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "animation.h"
+#include <QSettings>
+#include <QStringList>
+#include <algorithm>
+
+static complex rootValue(const Keyframe &key, int i)
+{
+	// Value of i-th root
+	return key.params.roots[i].value();
+}
+
+static complex dampingValue(const Keyframe &key, int)
+{
+	// Damping factor
+	return key.params.damping;
+}
+
+static complex centerValue(const Keyframe &key, int)
+{
+	// Center of limits
+	const Limits &l = key.params.limits;
+	return complex(0.5 * (l.left() + l.right()), 0.5 * (l.top() + l.bottom()));
+}
+
+Keyframe::Keyframe() :
+	time(0)
+{
+}
+
+Animation::Animation() :
+	fps_(nf::DAF),
+	size_(nf::DSI, nf::DSI),
+	interpolation_(CatmullRom)
+{
+}
+
+bool Animation::load(const QString &file, QString *error)
+{
+	// General animation settings
+	QSettings ini(file, QSettings::IniFormat);
+	ini.beginGroup("Animation");
+	fps_ = qMax(1, ini.value("fps", nf::DAF).toInt());
+	size_ = ini.value("size", QSize(nf::DSI, nf::DSI)).toSize();
+	interpolation_ = ini.value("interpolation", "catmullrom").toString().toLower() == "linear" ? Linear : CatmullRom;
+	ini.endGroup();
+
+	// Keyframes are stored like exported settings in groups "Keyframe<n>"
+	keyframes_.clear();
+	for (const QString &group : ini.childGroups()) {
+		if (group.startsWith("Keyframe")) {
+			Keyframe key;
+			ini.beginGroup(group);
+			key.time = ini.value("time", 0).toDouble();
+			key.params.load(ini);
+			ini.endGroup();
+			keyframes_.append(key);
+		}
+	}
+	std::sort(keyframes_.begin(), keyframes_.end(), [](const Keyframe &a, const Keyframe &b) {
+		return a.time < b.time;
+	});
+
+	// Check keyframes
+	QString message;
+	if (keyframes_.isEmpty()) message = "No keyframes found";
+	else if (size_.width() < 2 || size_.height() < 2) message = "Invalid frame size";
+	for (const Keyframe &key : keyframes_) {
+		if (key.params.roots.count() != keyframes_.first().params.roots.count())
+			message = "All keyframes need the same number of roots";
+	}
+	if (error != nullptr) *error = message;
+	return message.isEmpty();
+}
+
+bool Animation::appendKeyframe(const QString &file, const Parameters &params)
+{
+	// Create animation group if new
+	QSettings ini(file, QSettings::IniFormat);
+	if (!ini.childGroups().contains("Animation")) {
+		ini.beginGroup("Animation");
+		ini.setValue("fps", nf::DAF);
+		ini.setValue("size", params.size);
+		ini.setValue("interpolation", "catmullrom");
+		ini.endGroup();
+	}
+
+	// Find last keyframe
+	int count = 0;
+	double last = -nf::DKI;
+	for (const QString &group : ini.childGroups()) {
+		if (group.startsWith("Keyframe")) {
+			last = qMax(last, ini.value(group + "/time", 0).toDouble());
+			++count;
+		}
+	}
+
+	// Append keyframe after the last one
+	ini.beginGroup("Keyframe" + QString::number(count));
+	ini.setValue("time", last + nf::DKI);
+	params.save(ini);
+	ini.endGroup();
+	ini.sync();
+	return ini.status() == QSettings::NoError;
+}
+
+int Animation::fps() const
+{
+	// Return frames per second
+	return fps_;
+}
+
+QSize Animation::size() const
+{
+	// Return frame size
+	return size_;
+}
+
+int Animation::frameCount() const
+{
+	// Return number of frames including first and last keyframe
+	return qRound(duration() * fps_) + 1;
+}
+
+double Animation::duration() const
+{
+	// Return time span between first and last keyframe
+	return keyframes_.isEmpty() ? 0 : keyframes_.last().time - keyframes_.first().time;
+}
+
+Parameters Animation::frame(int index) const
+{
+	// Return parameters of frame
+	return paramsAt(keyframes_.first().time + static_cast<double>(index) / fps_);
+}
+
+Parameters Animation::paramsAt(double time) const
+{
+	// Find segment [k, k + 1] containing time
+	int k = 0;
+	int last = keyframes_.count() - 1;
+	while (k < last - 1 && keyframes_[k + 1].time <= time) ++k;
+	const Keyframe &a = keyframes_[k];
+	const Keyframe &b = keyframes_[qMin(k + 1, last)];
+	double span = b.time - a.time;
+	double u = span > 0 ? qBound(0.0, (time - a.time) / span, 1.0) : 0.0;
+
+	// Start with keyframe and interpolate roots and damping
+	Parameters params = a.params;
+	params.size = size_;
+	params.scaleDown = false;
+	params.benchmark = false;
+	params.orbitMode = false;
+	for (int i = 0; i < params.roots.count(); ++i) {
+		params.roots[i].setValue(interpolate(k, u, rootValue, i));
+	}
+	params.damping = interpolate(k, u, dampingValue);
+	params.maxIterations = qRound((1 - u) * a.params.maxIterations + u * b.params.maxIterations);
+
+	// Zoom geometrically and move the center so that the zoom target stays in place
+	double h0 = a.params.limits.height();
+	double h1 = b.params.limits.height();
+	double h = h0 * pow(h1 / h0, u);
+	complex c0 = centerValue(a, 0);
+	complex c1 = centerValue(b, 0);
+	complex c = qAbs(h1 - h0) > 1e-12 * h0 ? c0 + (c1 - c0) * ((h0 - h) / (h0 - h1)) : interpolate(k, u, centerValue);
+
+	// Keep pixels square for the animation size
+	double w = h * size_.width() / size_.height();
+	params.limits.set(c.real() - 0.5 * w, c.real() + 0.5 * w, c.imag() + 0.5 * h, c.imag() - 0.5 * h);
+	return params;
+}
+
+complex Animation::interpolate(int k, double u, complex (*value)(const Keyframe &, int), int i) const
+{
+	// Neighbouring keyframes clamped at both ends
+	int last = keyframes_.count() - 1;
+	complex p1 = value(keyframes_[k], i);
+	complex p2 = value(keyframes_[qMin(k + 1, last)], i);
+	if (interpolation_ == Linear)
+		return p1 + (p2 - p1) * u;
+
+	// Uniform Catmull-Rom spline through the keyframes
+	complex p0 = value(keyframes_[qMax(k - 1, 0)], i);
+	complex p3 = value(keyframes_[qMin(k + 2, last)], i);
+	double u2 = u * u;
+	double u3 = u2 * u;
+	return 0.5 * (
+		2.0 * p1 +
+		(p2 - p0) * u +
+		(2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3) * u2 +
+		(3.0 * p1 - p0 - 3.0 * p2 + p3) * u3);
+}
@@ -0,0 +1,43 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "parameters.h"
+#include <QString>
+
+enum Interpolation : quint8 { Linear, CatmullRom };
+
+struct Keyframe {
+	Keyframe();
+	double time;
+	Parameters params;
+};
+
+class Animation
+{
+public:
+	Animation();
+	bool load(const QString &file, QString *error = nullptr);
+	static bool appendKeyframe(const QString &file, const Parameters &params);
+
+	int fps() const;
+	QSize size() const;
+	int frameCount() const;
+	double duration() const;
+	Parameters frame(int index) const;
+	Parameters paramsAt(double time) const;
+
+private:
+	complex interpolate(int k, double u, complex (*value)(const Keyframe &, int), int i = 0) const;
+
+	int fps_;
+	QSize size_;
+	Interpolation interpolation_;
+	QVector<Keyframe> keyframes_;
+};
+
+#endif // ANIMATION_H
@@ -0,0 +1,113 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "animator.h"
+#include "renderer.h"
+#include <QtConcurrent>
+#include <QFutureWatcher>
+
+Animator::Animator(QObject *parent) :
+	QObject(parent),
+	frameCount_(0),
+	nextSubmit_(0),
+	nextWrite_(0),
+	inFlight_(0),
+	maxInFlight_(1),
+	stopped_(false)
+{
+}
+
+bool Animator::start(const Animation &animation, const QString &output)
+{
+	// Open output
+	animation_ = animation;
+	frameCount_ = animation.frameCount();
+	if (!writer_.open(output, animation.size(), animation.fps())) {
+		error_ = writer_.errorString();
+		return false;
+	}
+
+	// Every core renders its own frame -> no synchronisation within a frame
+	maxInFlight_ = QThread::idealThreadCount();
+	QThreadPool::globalInstance()->setMaxThreadCount(maxInFlight_);
+	nextSubmit_ = 0;
+	nextWrite_ = 0;
+	inFlight_ = 0;
+	stopped_ = false;
+	timer_.start();
+	submitFrames();
+	return true;
+}
+
+void Animator::stop()
+{
+	// Let frames in flight finish, but do not write them (or finish now if none are)
+	if (stopped_ || nextWrite_ == frameCount_) return;
+	stopped_ = true;
+	if (inFlight_ == 0) {
+		writer_.close();
+		emit finished(false);
+	}
+}
+
+QString Animator::errorString() const
+{
+	// Return last error
+	return error_;
+}
+
+void Animator::submitFrames()
+{
+	// Keep every core busy but limit the number of frames waiting to be written
+	while (!stopped_ && nextSubmit_ < frameCount_ && inFlight_ < maxInFlight_ && nextSubmit_ - nextWrite_ < 2 * maxInFlight_) {
+		int index = nextSubmit_++;
+		QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+		connect(watcher, &QFutureWatcher<QImage>::finished, [this, watcher, index]() {
+			finishFrame(index, watcher->result());
+			watcher->deleteLater();
+		});
+		watcher->setFuture(QtConcurrent::run(&Renderer::renderImage, animation_.frame(index), false, nullptr, nullptr));
+		++inFlight_;
+	}
+}
+
+void Animator::finishFrame(int index, const QImage &image)
+{
+	// Wait for remaining frames if stopped
+	--inFlight_;
+	if (stopped_) {
+		if (inFlight_ == 0) {
+			writer_.close();
+			emit finished(false);
+		}
+		return;
+	}
+
+	// Write finished frames in order
+	done_.insert(index, image);
+	while (done_.contains(nextWrite_)) {
+		if (!writer_.write(done_.take(nextWrite_))) {
+			error_ = writer_.errorString();
+			done_.clear();
+			stopped_ = true;
+			if (inFlight_ == 0) {
+				writer_.close();
+				emit finished(false);
+			}
+			return;
+		}
+		++nextWrite_;
+
+		// Report frames per second and remaining time
+		double fps = nextWrite_ * 1000.0 / qMax(qint64(1), timer_.elapsed());
+		emit progress(nextWrite_, frameCount_, fps, (frameCount_ - nextWrite_) * 1000.0 / fps);
+	}
+
+	// Done or submit more
+	if (nextWrite_ == frameCount_) {
+		writer_.close();
+		emit finished(true);
+	} else submitFrames();
+}
@@ -0,0 +1,48 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef ANIMATOR_H
+#define ANIMATOR_H
+
+#include "animation.h"
+#include "framewriter.h"
+#include <QMap>
+#include <QImage>
+#include <QObject>
+#include <QElapsedTimer>
+
+class Animator : public QObject
+{
+	Q_OBJECT
+
+public:
+	Animator(QObject *parent = nullptr);
+	bool start(const Animation &animation, const QString &output);
+	void stop();
+	QString errorString() const;
+
+protected:
+	void submitFrames();
+	void finishFrame(int index, const QImage &image);
+
+signals:
+	void progress(int frame, int frameCount, double fps, qint64 eta);
+	void finished(bool success);
+
+private:
+	Animation animation_;
+	FrameWriter writer_;
+	QElapsedTimer timer_;
+	QMap<int, QImage> done_;
+	int frameCount_;
+	int nextSubmit_;
+	int nextWrite_;
+	int inFlight_;
+	int maxInFlight_;
+	bool stopped_;
+	QString error_;
+};
+
+#endif // ANIMATOR_H
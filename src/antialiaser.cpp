@@ -0,0 +1,97 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "antialiaser.h"
+
+AntiAliaser::AntiAliaser()
+{
+	// Nothing measured yet
+	resetStats();
+}
+
+qint64 AntiAliaser::refine(QImage &image, const QImage &plain, QRect rect, const Parameters &params, const KernelPlan &plan, int samples)
+{
+	// Detect on the untouched image, write the means into the result
+	qint64 edges = 0;
+	for (int y = rect.top(); y <= rect.bottom(); ++y) {
+		QRgb *scanLine = (QRgb*)(image.scanLine(y));
+		for (int x = rect.left(); x <= rect.right(); ++x) {
+			if (!isEdge(plain, x, y)) continue;
+			scanLine[x] = supersample(x, y, params, plan, samples);
+			++edges;
+		}
+	}
+	return edges;
+}
+
+void AntiAliaser::measure(qint64 pixels, qint64 edges, int samples, qint64 renderNsecs, qint64 refineNsecs)
+{
+	// Thread time of the plain render and of the edges
+	samples_ = samples;
+	pixels_ += pixels;
+	edges_ += edges;
+	renderNsecs_ += renderNsecs;
+	refineNsecs_ += refineNsecs;
+}
+
+void AntiAliaser::resetStats()
+{
+	// Reset counters
+	samples_ = 1;
+	pixels_ = edges_ = 0;
+	renderNsecs_ = refineNsecs_ = 0;
+}
+
+QString AntiAliaser::report() const
+{
+	// Static output string
+	static const QString out = "Anti-aliasing: %1 % edge pixels with %2 samples each, %3x faster than uniform %2x supersampling (estimated)";
+
+	// Uniform supersampling renders every pixel samples times
+	const double plain = renderNsecs_;
+	const double uniform = samples_ * plain;
+	return out.arg(100.0 * edges_ / qMax(qint64(1), pixels_), 0, 'f', 1).arg(samples_)
+		.arg(uniform / qMax(1.0, plain + refineNsecs_), 0, 'f', 1);
+}
+
+bool AntiAliaser::isEdge(const QImage &image, int x, int y)
+{
+	// Any of the 8 neighbors visibly off in a channel (borders clamped)
+	const QRgb color = ((const QRgb*)(image.constScanLine(y)))[x];
+	for (int ny = qMax(0, y - 1); ny <= qMin(image.height() - 1, y + 1); ++ny) {
+		const QRgb *scanLine = (const QRgb*)(image.constScanLine(ny));
+		for (int nx = qMax(0, x - 1); nx <= qMin(image.width() - 1, x + 1); ++nx) {
+			const QRgb other = scanLine[nx];
+			if (qAbs(qRed(other) - qRed(color)) > nf::AAT || qAbs(qGreen(other) - qGreen(color)) > nf::AAT
+				|| qAbs(qBlue(other) - qBlue(color)) > nf::AAT) return true;
+		}
+	}
+	return false;
+}
+
+QRgb AntiAliaser::supersample(int x, int y, const Parameters &params, const KernelPlan &plan, int samples)
+{
+	// R2 sequence shifted by a hash of the pixel -> jittered, evenly spread for any sample count
+	static const double a1 = 0.7548776662466927, a2 = 0.5698402909980532;
+	quint32 hash = quint32(x) * 0x9e3779b1u ^ quint32(y) * 0x85ebca77u;
+	hash = (hash ^ (hash >> 15)) * 0x2c1b3c6du;
+	const double u0 = (hash & 0xffff) / 65536.0, v0 = (hash >> 16) / 65536.0;
+
+	// Sample the pixel's footprint, average the colors
+	const double xFactor = params.limits.width() / (params.size.width() - 1);
+	const double yFactor = -params.limits.height() / (params.size.height() - 1);
+	int red = 0, green = 0, blue = 0;
+	for (int k = 0; k < samples; ++k) {
+		double u = u0 + k * a1, v = v0 + k * a2;
+		u -= floor(u);
+		v -= floor(v);
+		fcomplex z((x - 0.5 + u) * xFactor + params.limits.left(), (y - 0.5 + v) * yFactor + params.limits.top());
+		QRgb color = iteratePoint(z, &params, plan);
+		red += qRed(color);
+		green += qGreen(color);
+		blue += qBlue(color);
+	}
+	return qRgb((red + samples / 2) / samples, (green + samples / 2) / samples, (blue + samples / 2) / samples);
+}
@@ -0,0 +1,40 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef ANTIALIASER_H
+#define ANTIALIASER_H
+
+#include "parameters.h"
+#include "kernel.h"
+#include <QImage>
+
+// Adaptive anti-aliasing: the palette has one shade per root and iteration count, so a pixel
+// with a neighbor more than nf::AAT off in a channel lies on a basin boundary or between two
+// visibly different iteration bands. Only these edge pixels are supersampled (jittered R2
+// pattern, Cranley-Patterson rotated per pixel) and replaced by the mean of their samples.
+// Runs per tile on a copy of the finished plain image (plain), so tiles see their neighbors.
+// Uniform supersampling would cost about samples times the plain render, which gives the speedup.
+class AntiAliaser
+{
+public:
+	AntiAliaser();
+	static qint64 refine(QImage &image, const QImage &plain, QRect rect, const Parameters &params, const KernelPlan &plan, int samples);
+	void measure(qint64 pixels, qint64 edges, int samples, qint64 renderNsecs, qint64 refineNsecs);
+	void resetStats();
+	QString report() const;
+
+protected:
+	static bool isEdge(const QImage &image, int x, int y);
+	static QRgb supersample(int x, int y, const Parameters &params, const KernelPlan &plan, int samples);
+
+private:
+	int samples_;
+	qint64 pixels_;
+	qint64 edges_;
+	qint64 renderNsecs_;
+	qint64 refineNsecs_;
+};
+
+#endif // ANTIALIASER_H
@@ -0,0 +1,135 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "basinmap.h"
+#include "renderer.h"
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <limits>
+
+BasinMap::BasinMap() :
+	width_(0),
+	height_(0),
+	left_(0),
+	right_(-1),
+	tileSize_(1),
+	columns_(1),
+	rows_(1),
+	originX_(0),
+	originY_(0),
+	scaleX_(0),
+	scaleY_(0)
+{
+}
+
+void BasinMap::create(const QVector<ImageTile> &tiles, const Parameters &params, QSize size, int left, int right, int tileSize)
+{
+	// Same grid as Renderer::createTiles, cells without a tile stay empty
+	width_ = size.width();
+	height_ = size.height();
+	left_ = left;
+	right_ = right;
+	tileSize_ = tileSize;
+	columns_ = qMax(1, (right - left + 1) / tileSize);
+	rows_ = qMax(1, height_ / tileSize);
+	uniform_.resize(width_ * height_);
+	cells_.fill(nullptr, columns_ * rows_);
+	for (const ImageTile &tile : tiles) {
+		cells_[tile.rect.top() / tileSize * columns_ + (tile.rect.left() - left) / tileSize] = &tile.done;
+	}
+
+	// Complex plane -> pixels
+	const Limits &l = params.limits;
+	originX_ = l.left();
+	originY_ = l.top();
+	scaleX_ = (width_ - 1) / l.width();
+	scaleY_ = (height_ - 1) / l.height();
+}
+
+void BasinMap::classify(const ImageTile &tile)
+{
+	// States of the rendered rows of the tile
+	const QRect &rect = tile.rect;
+	QVector<const PixelState*> rows(rect.height(), nullptr);
+	for (const ImageLine &il : tile.lines) rows[il.lineIndex - rect.top()] = il.states;
+
+	// Pixels inside the tile whose 3x3 neighborhood converged to one root, the rest is off limits
+	for (int r = 0; r < rect.height(); ++r) {
+		PixelState *out = uniform_.data() + qint64(rect.top() + r) * width_ + rect.left();
+		const PixelState *above = r > 0 ? rows[r - 1] : nullptr;
+		const PixelState *row = rows[r];
+		const PixelState *below = r < rect.height() - 1 ? rows[r + 1] : nullptr;
+		for (int x = 0; x < rect.width(); ++x) {
+			out[x] = {0, OrbitEscaped};
+			if (above == nullptr || row == nullptr || below == nullptr || x == 0 || x == rect.width() - 1) continue;
+			const qint16 root = row[x].root;
+			if (root < 0) continue;
+			bool uniform = true;
+			for (int dx = -1; dx <= 1; ++dx) {
+				uniform = uniform && above[x + dx].root == root && row[x + dx].root == root && below[x + dx].root == root;
+			}
+			if (uniform) out[x] = row[x];
+		}
+	}
+}
+
+QString BasinMap::report(const Parameters &params, const Calibration &calibration)
+{
+	// Static output string
+	static const QString out = "Basin lookup: %1x faster, %2 % of the pixels differ (%3 % in their root), %4 iterations off on average";
+
+	// Same view exactly and with lookups, best of nf::CRP runs each
+	QVector<PixelState> exact, approximate;
+	qint64 exactTime = std::numeric_limits<qint64>::max(), lookupTime = exactTime;
+	for (int run = 0; run < nf::CRP; ++run) {
+		exactTime = qMin(exactTime, render(params, calibration, exact, false));
+		lookupTime = qMin(lookupTime, render(params, calibration, approximate, true));
+	}
+
+	// Pixels with another root or iteration count, iteration error of the ones with the same root
+	qint64 differ = 0, roots = 0, same = 0;
+	double error = 0;
+	for (int i = 0; i < exact.count(); ++i) {
+		const PixelState &a = exact[i], &b = approximate[i];
+		if (a.root != b.root) ++roots;
+		else {
+			++same;
+			error += qAbs(int(a.iterations) - int(b.iterations));
+		}
+		if (a.root != b.root || a.iterations != b.iterations) ++differ;
+	}
+	const double pixels = qMax(1, exact.count());
+	return out.arg(double(exactTime) / qMax(qint64(1), lookupTime), 0, 'f', 2)
+		.arg(100.0 * differ / pixels, 0, 'f', 2).arg(100.0 * roots / pixels, 0, 'f', 2)
+		.arg(error / qMax(qint64(1), same), 0, 'f', 2);
+}
+
+qint64 BasinMap::render(const Parameters &params, const Calibration &calibration, QVector<PixelState> &states, bool lookups)
+{
+	// Double precision tiles of the whole view, every pixel keeps its outcome
+	QImage image(params.size, QImage::Format_RGB32);
+	const KernelPlan plan = createPlan(params);
+	const int width = params.size.width(), height = params.size.height();
+	const QVector<bool> filled(height, false);
+	QVector<ImageTile> tiles;
+	Renderer::createTiles(tiles, image, filled, params, &plan, calibration.tileSize, QPointF(0.5 * width, 0.5 * height));
+	states.fill(PixelState{0, OrbitCapped}, width * height);
+	BasinMap basins;
+	basins.create(tiles, params, params.size, 0, width - 1, calibration.tileSize);
+	for (ImageTile &tile : tiles) {
+		if (lookups) tile.basins = &basins;
+		for (ImageLine &il : tile.lines) {
+			il.states = states.data() + qint64(il.lineIndex) * width + tile.rect.left();
+			if (lookups) il.basins = &basins;
+		}
+	}
+
+	// Time the tiles only
+	QThreadPool::globalInstance()->setMaxThreadCount(calibration.threads);
+	QElapsedTimer timer;
+	timer.start();
+	QtConcurrent::blockingMap(tiles, Renderer::renderTile);
+	return timer.nsecsElapsed();
+}
@@ -0,0 +1,61 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef BASINMAP_H
+#define BASINMAP_H
+
+#include "parameters.h"
+#include "imageline.h"
+
+struct Calibration;
+
+// Approximate in-frame memo of the basins: an orbit that lands on a pixel of a finished tile
+// whose 3x3 neighborhood converged to one root takes that root and adds the iterations of
+// the pixel. Tiles classify their pixels when they are done, borders and rows not rendered
+// (speculator, symmetry) are off limits. The report renders the view exactly and with
+// lookups to show the error and the speedup.
+class BasinMap
+{
+public:
+	BasinMap();
+	void create(const QVector<ImageTile> &tiles, const Parameters &params, QSize size, int left, int right, int tileSize);
+	void classify(const ImageTile &tile);
+	const PixelState *lookup(fcomplex z) const;
+	static QString report(const Parameters &params, const Calibration &calibration);
+
+protected:
+	static qint64 render(const Parameters &params, const Calibration &calibration, QVector<PixelState> &states, bool lookups);
+
+private:
+	QVector<PixelState> uniform_;
+	QVector<const QAtomicInt*> cells_;
+	int width_;
+	int height_;
+	int left_;
+	int right_;
+	int tileSize_;
+	int columns_;
+	int rows_;
+	double originX_;
+	double originY_;
+	double scaleX_;
+	double scaleY_;
+};
+
+inline const PixelState *BasinMap::lookup(fcomplex z) const
+{
+	// Nearest pixel, off the rendered columns (or NaN) -> nothing
+	const double fx = (z.real() - originX_) * scaleX_ + 0.5, fy = (originY_ - z.imag()) * scaleY_ + 0.5;
+	if (!(fx >= left_ && fx < right_ + 1 && fy >= 0 && fy < height_)) return nullptr;
+	const int x = int(fx), y = int(fy);
+
+	// Classified once the tile is done
+	const QAtomicInt *done = cells_[qMin(y / tileSize_, rows_ - 1) * columns_ + qMin((x - left_) / tileSize_, columns_ - 1)];
+	if (done == nullptr || done->loadAcquire() == 0) return nullptr;
+	const PixelState *state = uniform_.constData() + qint64(y) * width_ + x;
+	return state->root >= 0 ? state : nullptr;
+}
+
+#endif // BASINMAP_H
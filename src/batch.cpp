@@ -0,0 +1,250 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "batch.h"
+#include "animator.h"
+#include "zoomvideo.h"
+#include "sweep.h"
+#include "renderer.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QSettings>
+#include <QFileInfo>
+#include <QDir>
+#include <QElapsedTimer>
+#include <cstdio>
+
+static const QStringList batchOptions = { "animate", "zoom-video", "sweep", "compare-methods", "degree-scaling" };
+
+static int runAnimation(QCoreApplication &app, const QString &file, const QString &output)
+{
+	// Load keyframes
+	QTextStream err(stderr);
+	Animation animation;
+	QString error;
+	if (!animation.load(file, &error)) {
+		err << file << ": " << error << "\n";
+		return 1;
+	}
+
+	// Print progress and quit when done
+	Animator animator;
+	QObject::connect(&animator, &Animator::progress, [&err](int frame, int frameCount, double fps, qint64 eta) {
+		err << QString("\rFrame %1 / %2, %3 fps, ETA %4:%5   ")
+			.arg(frame).arg(frameCount).arg(fps, 0, 'f', 2)
+			.arg(eta / 60000).arg((eta / 1000) % 60, 2, 10, QChar('0'));
+		err.flush();
+	});
+	QObject::connect(&animator, &Animator::finished, [&app, &animator, &err](bool success) {
+		if (!success) err << "\n" << animator.errorString();
+		err << "\n";
+		app.exit(success ? 0 : 1);
+	});
+
+	// Render
+	if (!animator.start(animation, output)) {
+		err << output << ": " << animator.errorString() << "\n";
+		return 1;
+	}
+	return app.exec();
+}
+
+static int runZoomVideo(const QCommandLineParser &parser, const QString &file)
+{
+	// Load start view from exported settings
+	QTextStream err(stderr);
+	QSettings ini(file, QSettings::IniFormat);
+	Parameters params;
+	params.load(ini);
+	if (params.roots.count() < 2) {
+		err << file << ": No roots found\n";
+		return 1;
+	}
+
+	// Zoom into the center of the view
+	bool expMap = parser.isSet("exp-map");
+	double oversample = parser.value("oversample").isEmpty() ? (expMap ? 1.0 : 2.0) : parser.value("oversample").toDouble();
+	ZoomVideo video(params, string2size(parser.value("size"), params.size),
+		parser.value("frames").toInt(), parser.value("zoom").toDouble());
+	QObject::connect(&video, &ZoomVideo::progress, [&err](const QString &stage, int done, int total) {
+		err << QString("\r%1 %2 / %3   ").arg(stage).arg(done).arg(total);
+		err.flush();
+	});
+
+	// Render
+	bool success = video.render(parser.value("output"), parser.value("fps").toInt(), expMap ? ZoomExpMap : ZoomKeyframes, oversample);
+	err << "\n" << (success ? video.report() : video.errorString()) << "\n";
+	return success ? 0 : 1;
+}
+
+static int runSweep(const QString &file, const QString &output)
+{
+	// Expand sweep spec into cells
+	QTextStream err(stderr);
+	Sweep sweep;
+	QString error;
+	if (!sweep.load(file, &error)) {
+		err << file << ": " << error << "\n";
+		return 1;
+	}
+
+	// Render contact sheet
+	QImage sheet = sweep.render();
+	if (!sheet.save(output)) {
+		err << output << ": Could not write image\n";
+		return 1;
+	}
+
+	// Write per-cell timing next to the sheet and to stdout
+	QFileInfo info(output);
+	QFile csv(info.dir().filePath(info.completeBaseName() + ".csv"));
+	QString report = sweep.report();
+	if (csv.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+		csv.write(report.toUtf8());
+	QTextStream(stdout) << report;
+	return 0;
+}
+
+static int runMethodComparison(const QCommandLineParser &parser, const QString &file)
+{
+	// Static output strings
+	static const QStringList names = { "Newton", "Halley", "Householder", "Schroeder" };
+	static const QString row = "%1 %2 %3 %4\n";
+
+	// Load view from exported settings
+	QTextStream out(stdout);
+	QSettings ini(file, QSettings::IniFormat);
+	Parameters params;
+	params.load(ini);
+	params.size = string2size(parser.value("size"), params.size);
+	params.scaleDown = false;
+	if (params.roots.count() < 2) {
+		QTextStream(stderr) << file << ": No roots found\n";
+		return 1;
+	}
+
+	// Render the same view with every method
+	const double pixels = double(params.size.width()) * params.size.height();
+	out << row.arg("method", -12).arg("ms", 10).arg("iter/pixel", 12).arg("eval/pixel", 12);
+	for (int m = NEWTON; m <= SCHROEDER; ++m) {
+		params.method = static_cast<Method>(m);
+		KernelStats stats;
+		QElapsedTimer timer;
+		timer.start();
+		Renderer::renderImage(params, true, &stats);
+		out << row.arg(names[m], -12).arg(timer.nsecsElapsed() / 1e6, 10, 'f', 1)
+			.arg((stats.iterations + stats.estimated) / pixels, 12, 'f', 2)
+			.arg(stats.iterations / pixels, 12, 'f', 2);
+		out.flush();
+	}
+	return 0;
+}
+
+static int runDegreeScaling(const QCommandLineParser &parser)
+{
+	// Static output string
+	static const QString row = "%1 %2 %3 %4 %5 %6\n";
+
+	// Unit disk view
+	QTextStream out(stdout);
+	Parameters params;
+	params.size = string2size(parser.value("size"), QSize(256, 256));
+	params.limits.set(-1.5, 1.5, 1.5, -1.5);
+	out << row.arg("roots", 6).arg("engine", -10).arg("ms", 10).arg("Mpixel/s", 10).arg("iter/pixel", 11).arg("ns/root", 9);
+
+	// Roots on a sunflower spiral so they fill the disk evenly
+	const double pixels = double(params.size.width()) * params.size.height();
+	const double golden = nf::PI * (3 - sqrt(5.0));
+	for (int n = 4; n <= nf::MLR; n *= 2) {
+		params.roots.clear();
+		for (int i = 0; i < n; ++i) {
+			double radius = sqrt((i + 0.5) / n);
+			params.roots.append(Root(std::polar(radius, i * golden), QColor::fromHsv(i * 360 / n, 255, 255)));
+		}
+
+		// Product form up to nf::MRC roots, else direct partial fractions and the grid far field
+		QStringList names;
+		QVector<KernelPlan> plans;
+		KernelPlan plan = createPlan(params);
+		if (n <= nf::MRC) {
+			names << "product";
+			plans << plan;
+		} else {
+			names << "direct" << "far-field";
+			plan.large.reset(new LargeKernel(params, false));
+			plans << plan;
+			plan.large.reset(new LargeKernel(params, true));
+			plans << plan;
+		}
+		for (int e = 0; e < plans.count(); ++e) {
+			KernelStats stats;
+			QElapsedTimer timer;
+			timer.start();
+			Renderer::renderImage(params, true, &stats, &plans[e]);
+			double ms = timer.nsecsElapsed() / 1e6;
+			out << row.arg(n, 6).arg(names[e], -10).arg(ms, 10, 'f', 1)
+				.arg(pixels / ms / 1000, 10, 'f', 2).arg(stats.iterations / pixels, 11, 'f', 2)
+				.arg(ms * 1e6 / qMax(1.0, double(stats.iterations) * n), 9, 'f', 3);
+			out.flush();
+		}
+	}
+	return 0;
+}
+
+bool isBatch(int argc, char *argv[])
+{
+	// Check for any batch option
+	for (int i = 1; i < argc; ++i) {
+		QString arg = QString::fromLocal8Bit(argv[i]);
+		for (const QString &option : batchOptions) {
+			if (arg == "--" + option || arg.startsWith("--" + option + "="))
+				return true;
+		}
+	}
+	return false;
+}
+
+int runBatch(QCoreApplication &app)
+{
+	// Command line options
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Renders newton fractals offline.");
+	parser.addHelpOption();
+	parser.addVersionOption();
+	QCommandLineOption animateOption("animate", "Render keyframe animation from ini <file>.", "file");
+	QCommandLineOption outputOption("output", "Directory for a PNG sequence, *.y4m file or - for Y4M on stdout.", "output", "frames");
+	QCommandLineOption zoomVideoOption("zoom-video", "Render a zoom into the center of the view from settings <file>.", "file");
+	QCommandLineOption sweepOption("sweep", "Render a contact sheet of the parameter sweep in ini <file>.", "file");
+	QCommandLineOption compareOption("compare-methods", "Compare iterations per pixel and time of all iteration methods on settings <file>.", "file");
+	QCommandLineOption scalingOption("degree-scaling", "Report render throughput for growing numbers of roots.");
+	parser.addOption(animateOption);
+	parser.addOption(zoomVideoOption);
+	parser.addOption(sweepOption);
+	parser.addOption(compareOption);
+	parser.addOption(scalingOption);
+	parser.addOption(outputOption);
+	parser.addOption(QCommandLineOption("frames", "Number of zoom video frames.", "count", "300"));
+	parser.addOption(QCommandLineOption("zoom", "Total zoom factor of the zoom video.", "factor", "1e6"));
+	parser.addOption(QCommandLineOption("size", "Zoom video, comparison or scaling size <width>x<height>.", "size"));
+	parser.addOption(QCommandLineOption("fps", "Zoom video frames per second.", "fps", QString::number(nf::DAF)));
+	parser.addOption(QCommandLineOption("oversample", "Resolution factor of keyframes (2) or exp-map strip (1).", "factor"));
+	parser.addOption(QCommandLineOption("exp-map", "Resample the zoom video from one log-polar strip instead of 2x keyframes."));
+	parser.process(app);
+
+	// Run job
+	if (parser.isSet(animateOption))
+		return runAnimation(app, parser.value(animateOption), parser.value(outputOption));
+	if (parser.isSet(zoomVideoOption))
+		return runZoomVideo(parser, parser.value(zoomVideoOption));
+	if (parser.isSet(sweepOption))
+		return runSweep(parser.value(sweepOption), parser.isSet(outputOption) ? parser.value(outputOption) : "sweep.png");
+	if (parser.isSet(compareOption))
+		return runMethodComparison(parser, parser.value(compareOption));
+	if (parser.isSet(scalingOption))
+		return runDegreeScaling(parser);
+	parser.showHelp(1);
+	return 1;
+}
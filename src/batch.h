@@ -0,0 +1,15 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef BATCH_H
+#define BATCH_H
+
+class QCoreApplication;
+
+// Offline jobs started from the command line without a window
+bool isBatch(int argc, char *argv[]);
+int runBatch(QCoreApplication &app);
+
+#endif // BATCH_H
@@ -0,0 +1,132 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "calibrator.h"
+#include "renderer.h"
+#include "floatkernel.h"
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QSettings>
+#include <QThread>
+#include <limits>
+
+Calibration::Calibration() :
+	threads(QThread::idealThreadCount()),
+	tileSize(nf::RTS),
+	lanes(nf::FPL)
+{
+}
+
+bool Calibration::load(QSettings &settings)
+{
+	// Nothing stored yet -> defaults
+	settings.beginGroup("Calibration");
+	bool stored = settings.contains("threads");
+	threads = qMax(1, settings.value("threads", QThread::idealThreadCount()).toInt());
+	tileSize = qMax(8, settings.value("tileSize", nf::RTS).toInt());
+	lanes = settings.value("lanes", nf::FPL).toInt();
+	settings.endGroup();
+	return stored;
+}
+
+void Calibration::save(QSettings &settings) const
+{
+	// Winners of the last calibration
+	settings.beginGroup("Calibration");
+	settings.setValue("threads", threads);
+	settings.setValue("tileSize", tileSize);
+	settings.setValue("lanes", lanes);
+	settings.endGroup();
+}
+
+QString Calibration::toString() const
+{
+	// Short form for the ui
+	return QString("%1 threads, %2 px tiles, %3 lanes").arg(threads).arg(tileSize).arg(lanes);
+}
+
+Calibration Calibrator::calibrate()
+{
+	// Candidates: physical cores (SMT) up to all logical ones, tile and lane sizes
+	const int ideal = QThread::idealThreadCount();
+	const QVector<int> threads = {qMax(1, ideal / 2), qMax(1, 3 * ideal / 4), ideal};
+	const QVector<int> tileSizes = {32, 64, 128};
+	const QVector<int> lanes = {4, 8, 16};
+	const Parameters params = scene();
+	const int previousThreads = QThreadPool::globalInstance()->maxThreadCount();
+	Calibration calibration;
+	qint64 best = std::numeric_limits<qint64>::max();
+
+	// Threads and tiles count for settled frames and previews, lanes for previews only
+	for (int count : threads) {
+		Calibration candidate = calibration;
+		candidate.threads = count;
+		qint64 time = measure(params, candidate, false) + measure(params, candidate, true);
+		if (time < best) {
+			best = time;
+			calibration = candidate;
+		}
+	}
+	best = std::numeric_limits<qint64>::max();
+	for (int size : tileSizes) {
+		Calibration candidate = calibration;
+		candidate.tileSize = size;
+		qint64 time = measure(params, candidate, false) + measure(params, candidate, true);
+		if (time < best) {
+			best = time;
+			calibration = candidate;
+		}
+	}
+	best = std::numeric_limits<qint64>::max();
+	for (int count : lanes) {
+		Calibration candidate = calibration;
+		candidate.lanes = count;
+		qint64 time = measure(params, candidate, true);
+		if (time < best) {
+			best = time;
+			calibration = candidate;
+		}
+	}
+
+	// Leave the pool as it was
+	QThreadPool::globalInstance()->setMaxThreadCount(previousThreads);
+	return calibration;
+}
+
+Parameters Calibrator::scene()
+{
+	// Default roots on a circle in the default view
+	Parameters params;
+	params.size = QSize(nf::CSI, nf::CSI);
+	for (int i = 0; i < nf::DRC; ++i) {
+		params.roots.append(Root(complex(0, 0), nf::predefColors[i]));
+	}
+	params.reset();
+	return params;
+}
+
+qint64 Calibrator::measure(const Parameters &params, const Calibration &calibration, bool preview)
+{
+	// Same tiles and kernels as the renderer
+	QImage image(params.size, QImage::Format_RGB32);
+	KernelPlan plan = createPlan(params);
+	plan.lanes = calibration.lanes;
+	if (preview) selectPrecision(plan, params, params.size);
+	QVector<ImageTile> tiles;
+	const QVector<bool> filled(params.size.height(), false);
+	Renderer::createTiles(tiles, image, filled, params, &plan, calibration.tileSize, QPointF(0.5 * params.size.width(), 0.5 * params.size.height()));
+	QThreadPool::globalInstance()->setMaxThreadCount(calibration.threads);
+
+	// Best of nf::CRP runs
+	qint64 best = std::numeric_limits<qint64>::max();
+	for (int run = 0; run < nf::CRP; ++run) {
+		for (ImageTile &tile : tiles) tile.done = 0;
+		QElapsedTimer timer;
+		timer.start();
+		QtConcurrent::blockingMap(tiles, Renderer::renderTile);
+		best = qMin(best, timer.nsecsElapsed());
+	}
+	return best;
+}
@@ -0,0 +1,36 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef CALIBRATOR_H
+#define CALIBRATOR_H
+
+#include "parameters.h"
+
+class QSettings;
+
+struct Calibration {
+	Calibration();
+	bool load(QSettings &settings);
+	void save(QSettings &settings) const;
+	QString toString() const;
+	int threads;
+	int tileSize;
+	int lanes;
+};
+
+// Finds the fastest thread count, render tile size and float lane count of this machine
+// on a representative scene (the default view at nf::CSI, settled and as float preview).
+// One candidate list after another, each with the winners so far, best of nf::CRP runs.
+class Calibrator
+{
+public:
+	static Calibration calibrate();
+
+protected:
+	static Parameters scene();
+	static qint64 measure(const Parameters &params, const Calibration &calibration, bool preview);
+};
+
+#endif // CALIBRATOR_H
@@ -0,0 +1,214 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "certifier.h"
+#include <QString>
+#include <cmath>
+
+static ComplexDisk operator+(const ComplexDisk &a, const ComplexDisk &b)
+{
+	// Sum of all points
+	return {a.center + b.center, a.radius + b.radius};
+}
+
+static ComplexDisk operator*(const ComplexDisk &a, const ComplexDisk &b)
+{
+	// Products of all points
+	return {a.center * b.center, abs(a.center) * b.radius + abs(b.center) * a.radius + a.radius * b.radius};
+}
+
+static bool inverse(const ComplexDisk &a, ComplexDisk &out)
+{
+	// Exact image of a disk that does not contain 0
+	const double denominator = norm(a.center) - a.radius * a.radius;
+	if (!(denominator > 0)) return false;
+	out = {conj(a.center) / denominator, a.radius / denominator};
+	return true;
+}
+
+TileCertifier::TileCertifier()
+{
+	// Nothing measured yet
+	resetStats();
+}
+
+bool TileCertifier::applicable(const Parameters &params, const KernelPlan &plan)
+{
+	// Capture disks exist for damped Newton only, cluster corrections and other precisions change the map
+	if (!params.certifyTiles || params.method != NEWTON || plan.large || plan.precision != DoublePrecision || !plan.clusters.isEmpty()) return false;
+	for (const CaptureDisk &disk : plan.disks) {
+		if (disk.radius <= 0) return false;
+	}
+	return !plan.disks.isEmpty();
+}
+
+void TileCertifier::render(ImageTile &tile)
+{
+	// Lines by row of the tile, blocks need all of their rows
+	const QRect &rect = tile.rect;
+	QVector<ImageLine*> rows(rect.height(), nullptr);
+	for (ImageLine &il : tile.lines) rows[il.lineIndex - rect.top()] = &il;
+	QVector<bool> certified(rect.width() * rect.height(), false);
+	if (rect.width() > 1) certifyBlock(tile, rows, QRect(0, 0, rect.width(), rect.height()), certified);
+
+	// Remaining pixels one by one in runs
+	for (int y = 0; y < rect.height(); ++y) {
+		if (rows[y] == nullptr) continue;
+		const bool *row = certified.constData() + y * rect.width();
+		for (int x = 0; x < rect.width();) {
+			int end = x;
+			while (end < rect.width() && !row[end]) ++end;
+			if (end > x) iterateSpan(*rows[y], x, end);
+			x = end + 1;
+		}
+	}
+}
+
+void TileCertifier::measure(const KernelStats &stats, qint64 pixels)
+{
+	// Frames rendered with certification only
+	certified_ += stats.certified;
+	pixels_ += pixels;
+}
+
+void TileCertifier::resetStats()
+{
+	// Reset counters
+	certified_ = pixels_ = 0;
+}
+
+QString TileCertifier::report() const
+{
+	// Static output string
+	static const QString out = "Tile certification: %1 % of the pixels filled by certified blocks";
+
+	// Share of the rendered pixels
+	return out.arg(100.0 * certified_ / qMax(qint64(1), pixels_), 0, 'f', 1);
+}
+
+void TileCertifier::certifyBlock(ImageTile &tile, const QVector<ImageLine*> &rows, QRect block, QVector<bool> &certified)
+{
+	// Disk around the pixel centers of the block (same coordinates as the lines)
+	bool complete = true;
+	for (int y = block.top(); y <= block.bottom(); ++y) complete = complete && rows[y] != nullptr;
+	if (complete) {
+		const ImageLine &first = *rows[block.top()], &last = *rows[block.bottom()];
+		const Parameters &params = *first.params;
+		const KernelPlan &plan = *first.plan;
+		const double xFactor = first.hx;
+		const double x0 = block.left() * xFactor + params.limits.left(), x1 = block.right() * xFactor + params.limits.left();
+		const ComplexDisk z = {complex(0.5 * (x0 + x1), 0.5 * (first.zy + last.zy)), 0.5 * hypot(x1 - x0, first.zy - last.zy) * (1 + nf::ICS)};
+
+		// Proven -> one color for the whole block
+		int root;
+		quint16 iterations;
+		if (certify(params, plan, z, root, iterations)) {
+			const QRgb color = plan.palette[root * params.maxIterations + iterations];
+			for (int y = block.top(); y <= block.bottom(); ++y) {
+				ImageLine &il = *rows[y];
+				for (int x = block.left(); x <= block.right(); ++x) {
+					il.scanLine[x] = color;
+					if (il.states) il.states[x] = {iterations, qint16(root)};
+					il.stats.converged(iterations, params.maxIterations);
+					certified[y * tile.rect.width() + x] = true;
+				}
+				il.stats.certified += block.width();
+			}
+			return;
+		}
+	}
+
+	// Quadrants (halves of the longer sides) down to nf::ICM pixels
+	if (block.width() <= nf::ICM && block.height() <= nf::ICM) return;
+	const int w = block.width() > nf::ICM ? block.width() / 2 : block.width();
+	const int h = block.height() > nf::ICM ? block.height() / 2 : block.height();
+	certifyBlock(tile, rows, QRect(block.left(), block.top(), w, h), certified);
+	if (w < block.width()) certifyBlock(tile, rows, QRect(block.left() + w, block.top(), block.width() - w, h), certified);
+	if (h < block.height()) certifyBlock(tile, rows, QRect(block.left(), block.top() + h, w, block.height() - h), certified);
+	if (w < block.width() && h < block.height()) certifyBlock(tile, rows, QRect(block.left() + w, block.top() + h, block.width() - w, block.height() - h), certified);
+}
+
+bool TileCertifier::certify(const Parameters &params, const KernelPlan &plan, ComplexDisk z, int &root, quint16 &iterations)
+{
+	// Same loop as iterateOrbit on the disk of all orbits, the center orbit is exact
+	const complex d = params.damping;
+	const int rootCount = plan.roots.count();
+	ComplexDisk saved = z;
+	quint32 power = 1, period = 0;
+	for (quint16 i = 0; i < qMin(params.maxIterations, nf::ICK); ++i) {
+
+		// All orbits inside one capture disk -> error recurrence, some of them -> not uniform
+		for (int r = 0; r < rootCount; ++r) {
+			const CaptureDisk &disk = plan.disks[r];
+			const double distance = abs(z.center - complex(disk.root));
+			if (distance + z.radius < disk.radius) {
+				root = r;
+				return capture(params, disk, {z.center - complex(disk.root), z.radius}, i, iterations);
+			}
+			if (distance - z.radius < disk.radius) return false;
+		}
+
+		// S1 = sum 1 / (z - r), S2 = sum 1 / (z - r)^2 on the disk, S1 at the center
+		ComplexDisk s1 = {0, 0}, s2 = {0, 0};
+		complex point = 0;
+		for (int r = 0; r < rootCount; ++r) {
+			ComplexDisk w;
+			if (!inverse({z.center - complex(plan.roots[r]), z.radius}, w)) return false;
+			s1 = s1 + w;
+			s2 = s2 + w * w;
+			point += 1.0 / (z.center - complex(plan.roots[r]));
+		}
+
+		// N(z) = z - d / S1 in mean-value form with |N'| = |1 - d S2 / S1^2| on the disk
+		ComplexDisk q;
+		if (!inverse(s1 * s1, q)) return false;
+		q = q * s2;
+		const double lipschitz = abs(1.0 - d * q.center) + abs(d) * q.radius;
+		const complex z0 = z.center - d / point;
+		const ComplexDisk next = {z0, lipschitz * z.radius + nf::ICS * (1 + abs(z0))};
+
+		// None of the orbits may diverge, converge outside the capture disks (short step near a root)
+		// or return to the saved point (long step onto it)
+		if (!std::isfinite(z0.real()) || !std::isfinite(z0.imag()) || abs(z0) + next.radius > nf::ESR) return false;
+		const double stepMin = abs(z0 - z.center) - next.radius - z.radius;
+		const double stepMax = abs(z0 - z.center) + next.radius + z.radius;
+		for (int r = 0; r < rootCount && stepMin < nf::EPS; ++r) {
+			if (abs(z0 - complex(plan.roots[r])) - next.radius < nf::EPS) return false;
+		}
+		if (stepMax >= nf::EPS && abs(z0 - saved.center) - next.radius - saved.radius < nf::EPS * nf::EPS) return false;
+		if (++period == power) {
+			saved = next;
+			power *= 2;
+			period = 0;
+		}
+		z = next;
+	}
+	return false;
+}
+
+bool TileCertifier::capture(const Parameters &params, const CaptureDisk &disk, ComplexDisk e, quint16 i, quint16 &iterations)
+{
+	// Error recurrence with S' in sum + e sum2 + remainder encloses the exact steps of the kernel,
+	// the convergence test has to hold for all errors at once
+	const ComplexDisk d = {1.0 - params.damping, 0};
+	const ComplexDisk sum = {complex(disk.sum), 0}, sum2 = {complex(disk.sum2), 0};
+	const double scale = 1 + abs(complex(disk.root));
+	for (; i < params.maxIterations; ++i) {
+		const double error = abs(e.center) + e.radius;
+		const ComplexDisk remainder = {0, 1.5 * error * error * disk.sum3};
+		ComplexDisk es = e * (sum + e * sum2 + remainder), denominator;
+		if (!inverse({1.0 + es.center, es.radius}, denominator)) return false;
+		const ComplexDisk e0 = e * (d + es) * denominator;
+		const ComplexDisk step = {e0.center - e.center, e0.radius + e.radius};
+		const double stepMax = abs(step.center) + step.radius, errorMax = abs(e0.center) + e0.radius;
+		if (stepMax < nf::EPS && errorMax < nf::EPS) {
+			iterations = i;
+			return true;
+		}
+		if (abs(step.center) - step.radius < nf::EPS && abs(e0.center) - e0.radius < nf::EPS) return false;
+		e = {e0.center, e0.radius + nf::ICS * (scale + abs(e0.center))};
+	}
+	return false;
+}
@@ -0,0 +1,44 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef CERTIFIER_H
+#define CERTIFIER_H
+
+#include "parameters.h"
+#include "kernel.h"
+
+struct ComplexDisk {
+	complex center;
+	double radius;
+};
+
+// Proves with disk (midpoint-radius) arithmetic that every pixel of a block takes the same path
+// through the kernel: no exit test holds for any of them until the block lies in one capture disk
+// (within nf::ICK steps), then the error recurrence meets the convergence test at the same step
+// for all of them. Such blocks are filled with one color, the others split into quadrants down
+// to nf::ICM pixels.
+// The Newton map is enclosed in mean-value form (Lipschitz bound from N' = 1 - d S2 / S1^2),
+// nf::ICS per step covers rounding. Newton with capture disks and without root clusters only.
+class TileCertifier
+{
+public:
+	TileCertifier();
+	static bool applicable(const Parameters &params, const KernelPlan &plan);
+	static void render(ImageTile &tile);
+	void measure(const KernelStats &stats, qint64 pixels);
+	void resetStats();
+	QString report() const;
+
+protected:
+	static void certifyBlock(ImageTile &tile, const QVector<ImageLine*> &rows, QRect block, QVector<bool> &certified);
+	static bool certify(const Parameters &params, const KernelPlan &plan, ComplexDisk z, int &root, quint16 &iterations);
+	static bool capture(const Parameters &params, const CaptureDisk &disk, ComplexDisk e, quint16 i, quint16 &iterations);
+
+private:
+	qint64 certified_;
+	qint64 pixels_;
+};
+
+#endif // CERTIFIER_H
@@ -16,16 +16,56 @@ namespace nf {
 	static constexpr double  PI  = 3.141592653589793238463;	// Pi as a constexpr
 
 	static constexpr double  EPS = 1e-3;					// Max error allowed
+	static constexpr double  ESR = 1e10;					// Escape radius of diverging orbits
 	static constexpr quint8  RIR = 5;						// Root indicator radius
 	static constexpr quint8  OIR = 3;						// Orbit point indicator radius
 	static constexpr double  MOD = 0.2;						// Root drag speed modifier
 	static constexpr double  ZMF = 0.05;					// Zoom factor
 	static constexpr quint8  MRC = 10;						// Maximum root count
+	static constexpr quint16 MLR = 4096;					// Maximum root count of offline renders
+	static constexpr int     FMP = 12;						// Far-field expansion terms
+	static constexpr double  FMS = 2.5;						// Far-field separation (distance / cell radius)
+	static constexpr int     FMT = 1024;					// Root count to use the far-field approximation from
+	static constexpr int     RPC = 8;						// Roots per grid cell
+	static constexpr double  CRD = 1e-2;					// Max. distance of clustered roots (relative to the nearest other root)
+	static constexpr double  CSF = 4.0;						// Cluster spread factor (modified newton outside)
+	static constexpr int     FPL = 8;						// Float preview lanes
+	static constexpr double  FPR = 1e-5;					// Min. float preview resolution (relative to coordinates)
 
 	static constexpr quint8  DRC = 5;						// Default root count
 	static constexpr double  DSC = 0.5;						// Default scaledown factor
 	static constexpr complex DDP = complex(1, 0);			// Default damping factor
+	static constexpr double  DST = 0.05;					// Damping scrub step (mouse wheel)
 	static constexpr quint16 DTI = 400;						// Default timer interval
+	static constexpr quint16 RSD = 1000;					// Replay settle delay
+	static constexpr quint16 PTO = 100;						// Present timeout of rendered frames [ms]
+	static constexpr int     STS = 32;						// Speculative tile size
+	static constexpr double  SPM = 0.25;					// Speculative pan margin (relative to size)
+	static constexpr double  SGT = 1e-3;					// Speculative grid tolerance (pixel offset / spacing)
+	static constexpr quint16 DFT = 33;						// Default target frame time of previews [ms]
+	static constexpr double  GMS = 0.1;						// Governor min. preview scale
+	static constexpr quint16 GMI = 16;						// Governor min. iteration cap
+	static constexpr double  GSA = 0.3;						// Governor smoothing of the measured cost
+	static constexpr int     RTS = 64;						// Render tile size
+	static constexpr quint16 IPI = 50;						// Incremental presentation interval [ms]
+	static constexpr int     HGB = 64;						// Iteration histogram buckets
+	static constexpr double  AIT = 0.995;					// Auto iterations: converged fraction to reach
+	static constexpr double  AIS = 0.5;						// Auto iterations: smoothing when lowering the cap
+	static constexpr quint16 AIM = 8;						// Auto iterations: min. cap
+	static constexpr quint16 CSI = 384;						// Calibration scene size
+	static constexpr int     CRP = 2;						// Calibration runs per candidate
+	static constexpr double  SYE = 1e-9;					// Symmetry: max. distance of mapped roots
+	static constexpr double  SYP = 1e-3;					// Symmetry: max. offset of mapped pixels (relative to spacing)
+	static constexpr int     ICM = 8;						// Tile certification: min. block size
+	static constexpr quint16 ICK = 16;						// Tile certification: max. steps before a block has to be captured
+	static constexpr double  ICS = 1e-12;					// Tile certification: rounding slack per step (relative)
+	static constexpr int     AAT = 16;						// Anti-aliasing: max. channel difference of smooth neighbors
+	static constexpr int     AAM = 64;						// Anti-aliasing: max. samples per edge pixel
+	static constexpr int     PVR = 2;						// Parameter variant range (steps in each direction)
+	static constexpr qint64  PVM = 64 << 20;				// Max. memory of parameter variants [bytes]
+	static constexpr quint8  DAF = 30;						// Default animation fps
+	static constexpr double  DKI = 2.0;						// Default keyframe interval [s]
+	static constexpr qint64  MSP = 1 << 28;					// Max. exp-map strip pixels
 	static constexpr quint16 DMI = 160;						// Default max. iterations
 	static constexpr quint16 DSI = 700;						// Default size
 	static constexpr quint16 MSI = 128;						// Minimum size
@@ -37,6 +77,7 @@ namespace nf {
 		Qt::cyan, Qt::magenta, Qt::yellow,
 		QColor(255, 128, 0), QColor(128, 0, 255), QColor(0, 255, 128), QColor(128, 128, 128)
 	};
+	static const QColor NCC = Qt::white;					// Non-convergent color (cycle / divergence)
 }
 
 
@@ -0,0 +1,226 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "exporter.h"
+#include "renderer.h"
+#include <QElapsedTimer>
+#include <QtConcurrent>
+
+ImageExporter::ImageExporter(QObject *parent) :
+	QObject(parent),
+	phase_(ExportIdle),
+	tileSize_(nf::RTS),
+	renderNsecs_(0)
+{
+	// Connect signals
+	connect(&watcher_, &QFutureWatcher<void>::finished, this, &ImageExporter::onFinished);
+	connect(&watcher_, &QFutureWatcher<void>::progressValueChanged, this, &ImageExporter::onProgressChanged);
+	connect(&saver_, &QFutureWatcher<bool>::finished, this, &ImageExporter::onSaved);
+}
+
+Parameters ImageExporter::exportParams(const Parameters &params, QSize size)
+{
+	// Same center and height of the view, the width follows the aspect ratio of size
+	Parameters exported = params;
+	const Limits &l = params.limits;
+	const double cx = 0.5 * (l.left() + l.right()), cy = 0.5 * (l.top() + l.bottom());
+	const double h = l.height(), w = h * (size.width() - 1) / (size.height() - 1);
+	exported.size = size;
+	exported.limits.set(cx - 0.5 * w, cx + 0.5 * w, cy + 0.5 * h, cy - 0.5 * h);
+	exported.scaleDown = false;
+	exported.benchmark = false;
+	return exported;
+}
+
+bool ImageExporter::isRunning() const
+{
+	// Tiles, edges or png encoding left
+	return phase_ != ExportIdle;
+}
+
+bool ImageExporter::start(const Parameters &params, QSize size, const QString &file, int tileSize)
+{
+	// Tiles of a canceled export may still be running on the old image (drop its pending signals)
+	cancel();
+	watcher_.waitForFinished();
+	watcher_.setFuture(QFuture<void>());
+	stop();
+
+	// At least 2x2 pixels (pixel spacing), larger than QImage allows (2 GiB) or out of memory
+	if (size.width() < 2 || size.height() < 2) return false;
+	image_ = QImage(size, QImage::Format_RGB32);
+	if (image_.isNull()) return false;
+
+	// Tiles of the fundamental domain with the full iteration limit, nearest to the center first
+	params_ = exportParams(params, size);
+	plan_ = createPlan(params_);
+	symmetry_ = Symmetry(params_, plan_, size);
+	file_ = file;
+	tileSize_ = tileSize;
+	QVector<bool> filled(size.height(), false);
+	symmetry_.markRows(filled);
+	Renderer::createTiles(tiles_, image_, filled, params_, &plan_, tileSize, QPointF(0.5 * size.width(), 0.5 * size.height()), &symmetry_);
+	const bool certify = TileCertifier::applicable(params_, plan_);
+	for (ImageTile &tile : tiles_) tile.certify = certify;
+	nsecs_.fill(0, tiles_.count());
+	renderNsecs_ = 0;
+	antiAliaser_.resetStats();
+	phase_ = ExportTiles;
+	return true;
+}
+
+bool ImageExporter::resume()
+{
+	// Queue the tiles that are not done yet, false if there are none to render
+	if (phase_ != ExportTiles && phase_ != ExportMapping && phase_ != ExportEdges) return false;
+	if (watcher_.isRunning()) return true;
+	if (phase_ == ExportMapping) {
+		startMapping();
+		return true;
+	}
+	queue_.clear();
+	for (int i = 0; i < tiles_.count(); ++i) {
+		if (!tiles_[i].done.loadAcquire()) queue_.append(i);
+	}
+	const ExportPhase phase = phase_;
+	watcher_.setFuture(QtConcurrent::map(queue_, [this, phase](int index) { renderTile(index, phase); }));
+	return true;
+}
+
+void ImageExporter::preempt()
+{
+	// Drop queued tiles, running ones finish next to the frame (they only write the export)
+	// The mapping cannot be stopped, it finishes next to the frame as well
+	if (watcher_.isRunning() && phase_ != ExportMapping) watcher_.cancel();
+}
+
+void ImageExporter::cancel()
+{
+	// Drop the export, the mapping and png encoding cannot be stopped
+	if (phase_ != ExportTiles && phase_ != ExportMapping && phase_ != ExportEdges) return;
+	preempt();
+	phase_ = ExportIdle;
+	if (!watcher_.isRunning()) stop();
+}
+
+QString ImageExporter::report() const
+{
+	// Anti-aliasing rate of the last export
+	return params_.antiAliasing > 1 ? antiAliaser_.report() : QString();
+}
+
+void ImageExporter::renderTile(int index, ExportPhase phase)
+{
+	// Plain tile or its edges, thread time for the report
+	QElapsedTimer timer;
+	timer.start();
+	ImageTile &tile = tiles_[index];
+	if (phase == ExportTiles) {
+		Renderer::renderTile(tile);
+	} else {
+		edges_[index] = AntiAliaser::refine(image_, plain_, tile.rect, params_, plan_, params_.antiAliasing);
+		tile.done.storeRelease(1);
+	}
+	nsecs_[index] = timer.nsecsElapsed();
+}
+
+void ImageExporter::startMapping()
+{
+	// Symmetric parts and the plain copy for the edges in one pool thread (whole image)
+	const bool copy = params_.antiAliasing > 1;
+	watcher_.setFuture(QtConcurrent::run([this, copy]() {
+		symmetry_.apply(image_, params_, plan_);
+		if (copy) plain_ = image_.copy();
+	}));
+}
+
+bool ImageExporter::startEdges()
+{
+	// Tiles over the whole image, edges are detected on the plain copy
+	if (plain_.isNull()) return false;
+	const QVector<bool> filled(image_.height(), false);
+	Renderer::createTiles(tiles_, image_, filled, params_, &plan_, tileSize_, QPointF(0.5 * image_.width(), 0.5 * image_.height()));
+	nsecs_.fill(0, tiles_.count());
+	edges_.fill(0, tiles_.count());
+	phase_ = ExportEdges;
+	return true;
+}
+
+void ImageExporter::startSaving()
+{
+	// Encoding large images takes a while too -> one pool thread
+	phase_ = ExportSaving;
+	tiles_.clear();
+	plain_ = QImage();
+	emit progress(0, 0, 0);
+	saver_.setFuture(QtConcurrent::run([this]() {
+		return image_.save(file_, "png");
+	}));
+}
+
+void ImageExporter::stop()
+{
+	// Free the images and tiles
+	phase_ = ExportIdle;
+	tiles_.clear();
+	queue_.clear();
+	image_ = QImage();
+	plain_ = QImage();
+}
+
+void ImageExporter::onProgressChanged()
+{
+	// Plain tiles are the first half if the edges follow
+	int done = 0;
+	for (const ImageTile &tile : tiles_) done += tile.done.loadAcquire() != 0;
+	const int phases = params_.antiAliasing > 1 ? 2 : 1;
+	const int phase = phase_ == ExportEdges ? 1 : 0;
+	emit progress(0, 1000, 1000 * (phase + double(done) / qMax(1, tiles_.count())) / phases);
+}
+
+void ImageExporter::onFinished()
+{
+	// Canceled -> dropped, preempted -> resumed when the renderer is idle
+	if (phase_ == ExportIdle) {
+		stop();
+		return;
+	}
+	if (watcher_.future().isCanceled()) {
+		emit resumeRequested();
+		return;
+	}
+	if (phase_ == ExportTiles) {
+		for (qint64 nsecs : nsecs_) renderNsecs_ += nsecs;
+		phase_ = ExportMapping;
+		emit resumeRequested();
+	} else if (phase_ == ExportMapping) {
+		if (params_.antiAliasing < 2) {
+			startSaving();
+			return;
+		}
+		if (!startEdges()) {
+			stop();
+			emit finished(tr("Not enough memory to anti-alias %1x%2 pixels").arg(params_.size.width()).arg(params_.size.height()));
+			return;
+		}
+		emit resumeRequested();
+	} else if (phase_ == ExportEdges) {
+		qint64 edges = 0, nsecs = 0;
+		for (int i = 0; i < tiles_.count(); ++i) {
+			edges += edges_[i];
+			nsecs += nsecs_[i];
+		}
+		antiAliaser_.measure(qint64(image_.width()) * image_.height(), edges, params_.antiAliasing, renderNsecs_, nsecs);
+		startSaving();
+	}
+}
+
+void ImageExporter::onSaved()
+{
+	// Done, the file may not have been writable
+	bool saved = saver_.result();
+	stop();
+	emit finished(saved ? QString() : tr("Could not write %1").arg(file_));
+}
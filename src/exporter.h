@@ -0,0 +1,76 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include "parameters.h"
+#include "imageline.h"
+#include "kernel.h"
+#include "symmetry.h"
+#include "antialiaser.h"
+#include <QObject>
+#include <QFutureWatcher>
+#include <QImage>
+
+enum ExportPhase : quint8 { ExportIdle, ExportTiles, ExportMapping, ExportEdges, ExportSaving };
+
+// Renders the view offscreen at any size with the tiles of the settled frames (symmetry and
+// certification included), then anti-aliases the edges tile by tile and saves the png.
+// Tiles share the thread pool with the renderer like the speculator: every frame preempts
+// the export without waiting (queued tiles are dropped, running ones finish next to the
+// frame), idle time resumes it. Work on the whole image (symmetry, plain copy for the edges,
+// encoding) runs in the pool too, never on the GUI thread.
+class ImageExporter : public QObject
+{
+	Q_OBJECT
+
+public:
+	ImageExporter(QObject *parent = nullptr);
+	static Parameters exportParams(const Parameters &params, QSize size);
+	bool isRunning() const;
+	bool start(const Parameters &params, QSize size, const QString &file, int tileSize);
+	bool resume();
+	void preempt();
+	void cancel();
+	QString report() const;
+
+protected:
+	void renderTile(int index, ExportPhase phase);
+	void startMapping();
+	bool startEdges();
+	void startSaving();
+	void stop();
+
+public slots:
+	void onProgressChanged();
+	void onFinished();
+	void onSaved();
+
+signals:
+	void progress(int min, int max, int progress);
+	void finished(const QString &error);
+	void resumeRequested();
+
+private:
+	ExportPhase phase_;
+	Parameters params_;
+	KernelPlan plan_;
+	Symmetry symmetry_;
+	QImage image_;
+	QImage plain_;
+	QString file_;
+	int tileSize_;
+	QVector<ImageTile> tiles_;
+	QVector<qint64> nsecs_;
+	QVector<qint64> edges_;
+	QVector<int> queue_;
+	qint64 renderNsecs_;
+	QFutureWatcher<void> watcher_;
+	QFutureWatcher<bool> saver_;
+	AntiAliaser antiAliaser_;
+};
+
+#endif // EXPORTER_H
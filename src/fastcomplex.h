@@ -0,0 +1,64 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef FASTCOMPLEX_H
+#define FASTCOMPLEX_H
+
+#include "defaults.h"
+#include <cmath>
+
+// Complex number for the hot loop: no NaN / Inf recovery like std::complex,
+// division multiplies with the reciprocal of the squared norm and products are
+// written as plain a * b +- c * d so the compiler can contract them into FMAs.
+// Build with CONFIG += strict_complex (NF_STRICT_COMPLEX) to use std::complex instead.
+class FastComplex
+{
+public:
+	constexpr FastComplex(double re = 0, double im = 0) : re_(re), im_(im) {}
+	constexpr FastComplex(const complex &z) : re_(z.real()), im_(z.imag()) {}
+	operator complex() const { return complex(re_, im_); }
+	constexpr double real() const { return re_; }
+	constexpr double imag() const { return im_; }
+
+	FastComplex &operator+=(const FastComplex &b) { re_ += b.re_; im_ += b.im_; return *this; }
+	FastComplex &operator-=(const FastComplex &b) { re_ -= b.re_; im_ -= b.im_; return *this; }
+	FastComplex &operator*=(const FastComplex &b) { *this = *this * b; return *this; }
+	FastComplex &operator*=(double b) { re_ *= b; im_ *= b; return *this; }
+	FastComplex &operator/=(const FastComplex &b) { *this = *this / b; return *this; }
+
+	friend FastComplex operator+(const FastComplex &a, const FastComplex &b) { return FastComplex(a.re_ + b.re_, a.im_ + b.im_); }
+	friend FastComplex operator-(const FastComplex &a, const FastComplex &b) { return FastComplex(a.re_ - b.re_, a.im_ - b.im_); }
+	friend FastComplex operator-(const FastComplex &a) { return FastComplex(-a.re_, -a.im_); }
+	friend FastComplex operator*(const FastComplex &a, const FastComplex &b) { return FastComplex(a.re_ * b.re_ - a.im_ * b.im_, a.re_ * b.im_ + a.im_ * b.re_); }
+	friend FastComplex operator*(double a, const FastComplex &b) { return FastComplex(a * b.re_, a * b.im_); }
+	friend FastComplex operator*(const FastComplex &a, double b) { return FastComplex(a.re_ * b, a.im_ * b); }
+	friend FastComplex operator/(const FastComplex &a, double b) { return a * (1.0 / b); }
+	friend FastComplex operator/(const FastComplex &a, const FastComplex &b) {
+		// a * conj(b) / |b|^2 with one division
+		const double inv = 1.0 / (b.re_ * b.re_ + b.im_ * b.im_);
+		return FastComplex((a.re_ * b.re_ + a.im_ * b.im_) * inv, (a.im_ * b.re_ - a.re_ * b.im_) * inv);
+	}
+	friend FastComplex operator/(double a, const FastComplex &b) {
+		const double inv = a / (b.re_ * b.re_ + b.im_ * b.im_);
+		return FastComplex(b.re_ * inv, -b.im_ * inv);
+	}
+	friend bool operator==(const FastComplex &a, const FastComplex &b) { return a.re_ == b.re_ && a.im_ == b.im_; }
+	friend bool operator!=(const FastComplex &a, const FastComplex &b) { return !(a == b); }
+
+	friend double norm(const FastComplex &z) { return z.re_ * z.re_ + z.im_ * z.im_; }
+	friend double abs(const FastComplex &z) { return std::sqrt(norm(z)); }
+
+private:
+	double re_;
+	double im_;
+};
+
+#ifdef NF_STRICT_COMPLEX
+typedef complex fcomplex;
+#else
+typedef FastComplex fcomplex;
+#endif
+
+#endif // FASTCOMPLEX_H
@@ -0,0 +1,201 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef FLOATKERNEL_H
+#define FLOATKERNEL_H
+
+#include "kernel.h"
+#include <QSize>
+#include <cmath>
+#include <limits>
+
+// Preview tier for interactive frames: L pixels of a line are iterated together in
+// float32 lanes (plain loops over the lanes, vectorized by the compiler). Lanes that
+// are done keep running until the whole batch is done and their results are ignored.
+// Lanes whose step overflows float32 (orbits far outside the view) are redone in double.
+// L is calibrated per machine (KernelPlan::lanes, nf::FPL by default).
+
+inline void selectPrecision(KernelPlan &plan, const Parameters &params, QSize size)
+{
+	// Only plain newton with the product form has a float kernel
+	const int rootCount = params.roots.count();
+	plan.precision = DoublePrecision;
+	if (params.method != NEWTON || plan.large || !plan.clusters.isEmpty() || rootCount < 2) return;
+
+	// Float32 resolves about 7 digits relative to the largest coordinate -> pixels, root
+	// distances and the convergence radius must not be smaller than nf::FPR times it
+	double magnitude = 1;
+	double spacing = qMin(nf::EPS, qMin(params.limits.width() / (size.width() - 1), qAbs(params.limits.height()) / (size.height() - 1)));
+	magnitude = qMax(magnitude, abs(complex(params.limits.left(), params.limits.top())));
+	magnitude = qMax(magnitude, abs(complex(params.limits.right(), params.limits.top())));
+	magnitude = qMax(magnitude, abs(complex(params.limits.left(), params.limits.bottom())));
+	magnitude = qMax(magnitude, abs(complex(params.limits.right(), params.limits.bottom())));
+	for (int i = 0; i < rootCount; ++i) {
+		magnitude = qMax(magnitude, abs(params.roots[i].value()));
+		for (int j = i + 1; j < rootCount; ++j) {
+			spacing = qMin(spacing, abs(params.roots[i].value() - params.roots[j].value()));
+		}
+	}
+	if (spacing < nf::FPR * magnitude) return;
+
+	// |f'|^2 of the product form grows like n (2 magnitude)^(2n - 1) within the view and must fit
+	if (log(double(rootCount)) + (2 * rootCount - 1) * log(2 * magnitude) >= log(double(std::numeric_limits<float>::max()))) return;
+
+	// Roots in SoA layout
+	plan.precision = FloatPrecision;
+	plan.rootsRe.resize(rootCount);
+	plan.rootsIm.resize(rootCount);
+	for (int i = 0; i < rootCount; ++i) {
+		plan.rootsRe[i] = params.roots[i].value().real();
+		plan.rootsIm[i] = params.roots[i].value().imag();
+	}
+}
+
+template <int L>
+inline void iterateXLanes(ImageLine &il)
+{
+	// Constants of the line in float
+	const KernelPlan &plan = *il.plan;
+	const Parameters *params = il.params;
+	const int rootCount = plan.rootsRe.count();
+	const float *rootsRe = plan.rootsRe.constData();
+	const float *rootsIm = plan.rootsIm.constData();
+	const float dr = params->damping.real(), di = params->damping.imag();
+	const float eps2 = nf::EPS * nf::EPS, esr2 = nf::ESR * nf::ESR;
+	const float fmax = std::numeric_limits<float>::max();
+	const double left = params->limits.left();
+	const double xFactor = il.hx;
+
+	for (int x0 = 0; x0 < il.lineSize; x0 += L) {
+
+		// Start values of the batch (lanes past the line end are done already)
+		float zr[L], zi[L], sr[L], si[L];
+		float nr[L], ni[L], step[L];
+		bool done[L], redo[L];
+		int running = 0;
+		for (int l = 0; l < L; ++l) {
+			zr[l] = sr[l] = (x0 + l) * xFactor + left;
+			zi[l] = si[l] = il.zy;
+			done[l] = x0 + l >= il.lineSize;
+			if (!done[l]) ++running;
+		}
+
+		quint32 power = 1, period = 0;
+		quint16 i = 0;
+		for (; i < params->maxIterations && running > 0; ++i) {
+
+			// f and f' in product form for all lanes: a = r, b = l of func()
+			float ar[L], ai[L], br[L], bi[L];
+			for (int l = 0; l < L; ++l) {
+				ar[l] = zr[l] - rootsRe[0];
+				ai[l] = zi[l] - rootsIm[0];
+				br[l] = zr[l] - rootsRe[1];
+				bi[l] = zi[l] - rootsIm[1];
+			}
+			for (int k = 1; k < rootCount - 1; ++k) {
+				for (int l = 0; l < L; ++l) {
+					float cr = br[l] + ar[l], ci = bi[l] + ai[l];
+					float wr = zr[l] - rootsRe[k + 1], wi = zi[l] - rootsIm[k + 1];
+					float vr = zr[l] - rootsRe[k], vi = zi[l] - rootsIm[k];
+					br[l] = wr * cr - wi * ci;
+					bi[l] = wr * ci + wi * cr;
+					float tr = ar[l] * vr - ai[l] * vi;
+					ai[l] = ar[l] * vi + ai[l] * vr;
+					ar[l] = tr;
+				}
+			}
+
+			// Damped newton step d f / f' with one reciprocal per lane
+			for (int l = 0; l < L; ++l) {
+				float wr = zr[l] - rootsRe[rootCount - 1], wi = zi[l] - rootsIm[rootCount - 1];
+				float fr = ar[l] * wr - ai[l] * wi, fi = ar[l] * wi + ai[l] * wr;
+				float gr = br[l] + ar[l], gi = bi[l] + ai[l];
+				float den = gr * gr + gi * gi;
+				float inv = 1.0f / den;
+				float qr = (fr * gr + fi * gi) * inv, qi = (fi * gr - fr * gi) * inv;
+				float dzr = dr * qr - di * qi, dzi = dr * qi + di * qr;
+				nr[l] = zr[l] - dzr;
+				ni[l] = zi[l] - dzi;
+				step[l] = dzr * dzr + dzi * dzi;
+				redo[l] = !(den < fmax && inv < fmax && step[l] < fmax);
+			}
+
+			// Classify the lanes that are still running
+			for (int l = 0; l < L; ++l) {
+				if (done[l]) continue;
+				QRgb color = 0;
+
+				// Out of float range (NaN compares false too) -> the double kernel decides
+				if (redo[l]) {
+					il.scanLine[x0 + l] = iteratePoint(fcomplex((x0 + l) * xFactor + left, il.zy), params, plan, &il.stats);
+					done[l] = true;
+					--running;
+					continue;
+				}
+				if (step[l] < eps2) {
+					for (int r = 0; r < rootCount; ++r) {
+						float er = nr[l] - rootsRe[r], ei = ni[l] - rootsIm[r];
+						if (er * er + ei * ei < eps2) {
+							color = plan.palette[r * params->maxIterations + i];
+							done[l] = true;
+							il.stats.iterations += i + 1;
+							il.stats.converged(i, params->maxIterations);
+							break;
+						}
+					}
+				}
+				if (!done[l]) {
+					float er = nr[l] - sr[l], ei = ni[l] - si[l];
+					bool diverged = !std::isfinite(nr[l]) || !std::isfinite(ni[l]) || nr[l] * nr[l] + ni[l] * ni[l] > esr2;
+					bool cycle = step[l] >= eps2 && er * er + ei * ei < eps2 * eps2;
+					if (diverged || cycle) {
+						color = nf::NCC.rgb();
+						done[l] = true;
+						il.stats.iterations += i + 1;
+						il.stats.saved += params->maxIterations - i - 1;
+					}
+				}
+				if (done[l]) {
+					il.scanLine[x0 + l] = color;
+					--running;
+				}
+			}
+
+			// Brent cycle detection with one period for the whole batch
+			if (++period == power) {
+				for (int l = 0; l < L; ++l) {
+					sr[l] = nr[l];
+					si[l] = ni[l];
+				}
+				power *= 2;
+				period = 0;
+			}
+			for (int l = 0; l < L; ++l) {
+				zr[l] = nr[l];
+				zi[l] = ni[l];
+			}
+		}
+
+		// No root -> black
+		for (int l = 0; l < L; ++l) {
+			if (done[l]) continue;
+			il.scanLine[x0 + l] = qRgb(0, 0, 0);
+			il.stats.iterations += params->maxIterations;
+			++il.stats.capped;
+		}
+	}
+}
+
+inline void iterateXFloat(ImageLine &il)
+{
+	// Lane count of the plan
+	switch (il.plan->lanes) {
+	case 4: iterateXLanes<4>(il); break;
+	case 16: iterateXLanes<16>(il); break;
+	default: iterateXLanes<nf::FPL>(il);
+	}
+}
+
+#endif // FLOATKERNEL_H
@@ -6,8 +6,11 @@
 #include "fractalwidget.h"
 #include "settingswidget.h"
 #include "parameters.h"
+#include "animation.h"
 #include <QApplication>
 #include <QMessageBox>
+#include <QProgressDialog>
+#include <QInputDialog>
 #include <QFileDialog>
 #include <QMouseEvent>
 #include <QHBoxLayout>
@@ -15,6 +18,8 @@
 #include <QSettings>
 #include <QPainter>
 #include <QAction>
+#include <QVector4D>
+#include <limits>
 #include <QIcon>
 
 #define newSC(x) (new QShortcut(QKeySequence(x), this))
@@ -67,6 +72,9 @@ FractalWidget::FractalWidget(QWidget *parent) :
 	connect(newSC("Ctrl+S"), &QShortcut::activated, settingsWidget_, &SettingsWidget::exportImage);
 	connect(newSC("Ctrl+E"), &QShortcut::activated, settingsWidget_, &SettingsWidget::exportSettings);
 	connect(newSC("Ctrl+I"), &QShortcut::activated, settingsWidget_, &SettingsWidget::importSettings);
+	connect(newSC("Ctrl+K"), &QShortcut::activated, this, &FractalWidget::appendKeyframe);
+	connect(newSC(Qt::Key_F5), &QShortcut::activated, this, &FractalWidget::toggleRecording);
+	connect(newSC(Qt::Key_F6), &QShortcut::activated, this, &FractalWidget::replaySession);
 
 	// Connect settingswidget signals
 	connect(settingsWidget_, &SettingsWidget::paramsChanged, this, &FractalWidget::updateParams);
@@ -77,6 +85,7 @@ FractalWidget::FractalWidget(QWidget *parent) :
 	// Connect renderthread and timer signals
 	connect(&renderer_, &Renderer::fractalRendered, this, &FractalWidget::updateFractal);
 	connect(&renderer_, &Renderer::orbitRendered, this, &FractalWidget::updateOrbit);
+	connect(&renderer_, &Renderer::iterationsTuned, settingsWidget_, &SettingsWidget::setTunedIterations);
 	connect(&scaleDownTimer_, &QTimer::timeout, [this]() {
 		params_->scaleDown = false;
 		updateParams();
@@ -87,8 +96,17 @@ FractalWidget::FractalWidget(QWidget *parent) :
 	connect(settingsWidget_, &SettingsWidget::stopBenchmarkRequested, &renderer_, &Renderer::stop);
 	connect(&renderer_, &Renderer::benchmarkFinished, this, &FractalWidget::finishBenchmark);
 	connect(&renderer_, &Renderer::benchmarkProgress, settingsWidget_, &SettingsWidget::setBenchmarkProgress);
+	connect(settingsWidget_, &SettingsWidget::calibrateRequested, this, &FractalWidget::calibrate);
 
-	// Initialize parameters
+	// Connect recorder signals
+	connect(&renderer_, &Renderer::renderStarted, &recorder_, &Recorder::renderStarted);
+	connect(this, &QOpenGLWidget::frameSwapped, &recorder_, &Recorder::framePresented);
+	connect(this, &QOpenGLWidget::frameSwapped, &renderer_, &Renderer::framePresented);
+	connect(&recorder_, &Recorder::replayFinished, this, &FractalWidget::finishReplay);
+
+	// Calibrate on first launch once the window is shown, initialize parameters
+	if (!renderer_.loadCalibration()) QTimer::singleShot(0, this, &FractalWidget::calibrate);
+	settingsWidget_->setCalibration(renderer_.calibration().toString());
 	reset();
 }
 
@@ -103,23 +121,59 @@ void FractalWidget::updateParams()
 {
 	// Pass params to renderthread by const reference
 	if (enabled_) {
+		recorder_.inputSubmitted();
 		renderer_.render(*params_);
 	}
 }
 
 void FractalWidget::exportImageTo(const QString &dir)
 {
-	// Close settingsWidget
-	bool closed = settingsWidget_->isHidden();
-	settingsWidget_->setHidden(true);
+	// One export at a time
+	ImageExporter *exporter = renderer_.exporter();
+	if (exporter->isRunning()) {
+		if (exportProgress_) exportProgress_->show();
+		return;
+	}
+
+	// Any size, the view keeps its height
+	bool ok = false;
+	QString current = QString("%1x%2").arg(params_->size.width()).arg(params_->size.height());
+	QString text = QInputDialog::getText(this, tr("Export fractal"), tr("Size (<width>x<height>):"), QLineEdit::Normal, current, &ok);
+	if (!ok) return;
+	QSize size = string2size(text, params_->size);
+	if (size.width() < 2 || size.height() < 2) {
+		QMessageBox::warning(this, tr("Export failed"), tr("Exports need at least 2x2 pixels"));
+		return;
+	}
+	QString file = dir + "/" + dynamicFileName(ImageExporter::exportParams(*params_, size), "png");
 
-	// Export fractal to file
-	QFile f(dir + "/" + dynamicFileName(*params_, "png"));
-	f.open(QIODevice::WriteOnly | QIODevice::Truncate);
-	grab().save(&f, "png");
+	// Render offscreen in idle time (QImage is limited to 2 GiB)
+	if (!renderer_.exportImage(*params_, size, file)) {
+		QMessageBox::warning(this, tr("Export failed"), tr("Not enough memory for %1x%2 pixels").arg(size.width()).arg(size.height()));
+		return;
+	}
 
-	// Reopen if needed
-	settingsWidget_->setHidden(closed);
+	// Progress and cancel in a non-modal dialog
+	exportProgress_ = new QProgressDialog(tr("Exporting %1x%2 pixels...").arg(size.width()).arg(size.height()), tr("Cancel"), 0, 1000, this);
+	exportProgress_->setWindowModality(Qt::NonModal);
+	exportProgress_->setAutoClose(false);
+	exportProgress_->setAutoReset(false);
+	exportProgress_->setMinimumDuration(0);
+	QProgressDialog *dialog = exportProgress_;
+	connect(exporter, &ImageExporter::progress, dialog, [dialog](int min, int max, int progress) {
+		dialog->setRange(min, max);
+		dialog->setValue(progress);
+	});
+	connect(exporter, &ImageExporter::finished, dialog, [this, dialog, exporter](const QString &error) {
+		dialog->deleteLater();
+		if (!error.isEmpty()) QMessageBox::warning(this, tr("Export failed"), error);
+		else if (!exporter->report().isEmpty()) QMessageBox::information(this, tr("Image exported"), exporter->report());
+	});
+	connect(dialog, &QProgressDialog::canceled, dialog, [dialog, exporter]() {
+		exporter->cancel();
+		dialog->deleteLater();
+	});
+	dialog->show();
 }
 
 void FractalWidget::reset()
@@ -146,7 +200,7 @@ void FractalWidget::runBenchmark()
 void FractalWidget::finishBenchmark(const QImage *image)
 {
 	// Static output string
-	static const QString out = "Rendered %1 pixels in:\n%2 hr, %3 min, %4 sec and %5 ms";
+	static const QString out = "Rendered %1 pixels in:\n%2 hr, %3 min, %4 sec and %5 ms\n%6 iterations saved by early exits";
 
 	// Get time and number of pixels
 	if (image != nullptr) {
@@ -162,7 +216,7 @@ void FractalWidget::finishBenchmark(const QImage *image)
 		// Show stats
 		QMessageBox::StandardButton btn = QMessageBox::question(
 			this, tr("Benchmark finished"),
-			out.arg(pixels).arg(h).arg(m).arg(s).arg(ms),
+			out.arg(pixels).arg(h).arg(m).arg(s).arg(ms).arg(renderer_.stats().saved),
 			QMessageBox::Save | QMessageBox::Cancel);
 
 		// Save image
@@ -184,6 +238,85 @@ void FractalWidget::finishBenchmark(const QImage *image)
 	updateParams();
 }
 
+void FractalWidget::appendKeyframe()
+{
+	// Get animation file
+	QSettings settings;
+	QString dir = settings.value("settingsdir", QStandardPaths::standardLocations(QStandardPaths::DocumentsLocation)).toString();
+	QString file = settings.value("animationfile", dir).toString();
+	file = QFileDialog::getSaveFileName(this, tr("Append keyframe to"), file, tr("Ini-File (*.ini)"), nullptr, QFileDialog::DontConfirmOverwrite);
+	if (file.isEmpty()) return;
+
+	// Append current parameters
+	settings.setValue("animationfile", file);
+	Animation::appendKeyframe(file, *params_);
+}
+
+void FractalWidget::toggleRecording()
+{
+	// Start recording
+	if (recorder_.state() == NotRecording) {
+		recorder_.startRecording(*params_);
+		setWindowTitle(QApplication::applicationName() + tr(" - Recording"));
+		return;
+	}
+
+	// Stop recording and save session
+	if (recorder_.state() == Recording) {
+		QSettings settings;
+		QString dir = settings.value("settingsdir", QStandardPaths::standardLocations(QStandardPaths::DocumentsLocation)).toString();
+		QString file = QFileDialog::getSaveFileName(this, tr("Save recording"), dir, tr("Ini-File (*.ini)"));
+		recorder_.stopRecording(file);
+		setWindowTitle(QApplication::applicationName());
+	}
+}
+
+void FractalWidget::replaySession()
+{
+	// Open recorded session
+	if (recorder_.state() != NotRecording) return;
+	QSettings settings;
+	QString dir = settings.value("settingsdir", QStandardPaths::standardLocations(QStandardPaths::DocumentsLocation)).toString();
+	QString file = QFileDialog::getOpenFileName(this, tr("Replay recording"), dir, tr("Ini-File (*.ini)"));
+	if (file.isEmpty()) return;
+
+	// Restore initial state and replay
+	Parameters initial;
+	if (recorder_.load(file, initial)) {
+		settingsWidget_->applyParams(initial);
+		setWindowTitle(QApplication::applicationName() + tr(" - Replaying"));
+		renderer_.speculator()->resetStats();
+		renderer_.governor()->resetStats();
+		renderer_.tuner()->resetStats();
+		renderer_.certifier()->resetStats();
+		recorder_.replay(this);
+	}
+}
+
+void FractalWidget::finishReplay(const QString &report)
+{
+	// Show latency report
+	setWindowTitle(QApplication::applicationName());
+	QString reports = report + "\n" + renderer_.speculator()->report() + "\n" + renderer_.governor()->report() + "\n" + renderer_.tuner()->report();
+	if (params_->basinLookup) reports += "\n" + BasinMap::report(*params_, renderer_.calibration());
+	if (params_->certifyTiles) reports += "\n" + renderer_.certifier()->report();
+	QMessageBox::information(this, tr("Replay finished"), reports);
+}
+
+void FractalWidget::calibrate()
+{
+	// Benchmark thread count, tile size and float lanes again (blocks, paint the dialog first)
+	QProgressDialog dialog(tr("Calibrating thread count, tile size and float lanes..."), QString(), 0, 0, this);
+	dialog.setWindowModality(Qt::WindowModal);
+	dialog.setMinimumDuration(0);
+	dialog.show();
+	QApplication::processEvents();
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+	renderer_.calibrate();
+	QApplication::restoreOverrideCursor();
+	settingsWidget_->setCalibration(renderer_.calibration().toString());
+}
+
 void FractalWidget::enable(bool value)
 {
 	// Toggle all actions
@@ -194,10 +327,15 @@ void FractalWidget::enable(bool value)
 	}
 }
 
-void FractalWidget::updateFractal(const QPixmap &pixmap, double fps)
+void FractalWidget::updateFractal(const QPixmap &pixmap, const Limits &limits, double fps, bool partial)
 {
-	// Update
+	// Update, partial frames do not show the input yet
+	if (!partial) {
+		recorder_.frameRendered();
+		recorder_.imageRendered();
+	}
 	pixmap_ = pixmap;
+	pixmapLimits_ = limits;
 	fps_ = fps;
 	update();
 }
@@ -205,6 +343,7 @@ void FractalWidget::updateFractal(const QPixmap &pixmap, double fps)
 void FractalWidget::updateOrbit(const QVector<QPoint> &orbit, double fps)
 {
 	// Update
+	recorder_.frameRendered();
 	orbit_ = orbit;
 	fps_ = fps;
 	update();
@@ -226,6 +365,8 @@ void FractalWidget::initializeGL()
 	program_->link();
 	program_->bind();
 	program_->setUniformValue("EPS", float(nf::EPS));
+	program_->setUniformValue("ESR", float(nf::ESR));
+	program_->setUniformValue("CSF", float(nf::CSF));
 }
 
 void FractalWidget::paintGL()
@@ -265,8 +406,20 @@ void FractalWidget::paintGL()
 	glEnable(GL_MULTISAMPLE);
 
 	// Draw pixmap if rendered yet and cpu mode
+	// Until the next frame arrives the last one is reprojected onto the current limits
 	if (params_->processor != GPU_OPENGL && !pixmap_.isNull()) {
-		painter.drawPixmap(rect(), pixmap_);
+		const Limits &l = params_->limits;
+		if (pixmapLimits_ == l) {
+			painter.drawPixmap(rect(), pixmap_);
+		} else {
+			const double sx = width() / l.width();
+			const double sy = height() / l.height();
+			QRectF target((pixmapLimits_.left() - l.left()) * sx, (l.top() - pixmapLimits_.top()) * sy,
+				pixmapLimits_.width() * sx, pixmapLimits_.height() * sy);
+			painter.fillRect(rect(), Qt::black);
+			painter.setRenderHint(QPainter::SmoothPixmapTransform);
+			painter.drawPixmap(target, pixmap_, QRectF(pixmap_.rect()));
+		}
 	} else {
 		// Update params and draw
 		quint8 rootCount = params_->roots.count();
@@ -276,10 +429,25 @@ void FractalWidget::paintGL()
 		program_->setUniformValue("rootCount", rootCount);
 		program_->setUniformValue("limits", params_->limits.vec4());
 		program_->setUniformValue("maxIterations", params_->maxIterations);
+		program_->setUniformValue("method", static_cast<int>(params_->method));
 		program_->setUniformValue("damping", complex2vec2(params_->damping));
 		program_->setUniformValue("size", QVector2D(size().width(), size().height()));
 		program_->setUniformValueArray("roots", params_->rootsVec2().constData(), rootCount);
 		program_->setUniformValueArray("colors", params_->colorsVec3().constData(), rootCount);
+
+		// Root clusters like the cpu kernel
+		const QVector<RootCluster> clusters = params_->method == NEWTON ? params_->rootClusters() : QVector<RootCluster>();
+		QVector<QVector4D> shapes;
+		QVector<GLfloat> multiplicities;
+		for (const RootCluster &cluster : clusters) {
+			shapes.append(QVector4D(cluster.center.real(), cluster.center.imag(), cluster.spread, qMin(cluster.reach, double(std::numeric_limits<float>::max()))));
+			multiplicities.append(cluster.multiplicity);
+		}
+		program_->setUniformValue("clusterCount", clusters.count());
+		if (!clusters.isEmpty()) {
+			program_->setUniformValueArray("clusters", shapes.constData(), clusters.count());
+			program_->setUniformValueArray("multiplicities", multiplicities.constData(), clusters.count(), 1);
+		}
 		glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 	}
 
@@ -358,6 +526,7 @@ void FractalWidget::mousePressEvent(QMouseEvent *event)
 {
 	// Return if disabled
 	if (!enabled_) return;
+	recorder_.inputReceived(event);
 
 	// Set scaleDown, previousPos and orbit
 	QPoint pos = event->pos();
@@ -383,9 +552,11 @@ void FractalWidget::mouseMoveEvent(QMouseEvent *event)
 {
 	// Return if disabled
 	if (!enabled_) return;
+	recorder_.inputReceived(event);
 
 	// Move root if dragging
 	mousePosition = event->pos();
+	renderer_.setCursorPos(mousePosition);
 	if (dragger_.mode == DraggingRoot && dragger_.index >= 0 && dragger_.index < params_->roots.count()) {
 		if (event->modifiers() == Qt::KeyboardModifier::ShiftModifier) {
 			QPointF distance = mousePosition - dragger_.previousPos;
@@ -393,6 +564,7 @@ void FractalWidget::mouseMoveEvent(QMouseEvent *event)
 			dragger_.previousPos = mousePosition;
 		} else params_->roots[dragger_.index] = params_->point2complex(mousePosition);
 		settingsWidget_->moveRoot(dragger_.index, params_->roots[dragger_.index].value());
+		renderer_.setFocusPos(params_->complex2point(params_->roots[dragger_.index].value()));
 		updateParams();
 
 	// Else move fractal if dragging
@@ -424,6 +596,7 @@ void FractalWidget::mouseReleaseEvent(QMouseEvent *event)
 {
 	// Return if disabled
 	if (!enabled_) return;
+	recorder_.inputReceived(event);
 
 	// Reset dragging and render actual size
 	Q_UNUSED(event);
@@ -437,6 +610,7 @@ void FractalWidget::wheelEvent(QWheelEvent *event)
 {
 	// Return if disabled
 	if (!enabled_) return;
+	recorder_.inputReceived(event);
 
 	// Calculate weight
 	double xw = (double)event->pos().x() / width();
@@ -454,4 +628,7 @@ void FractalWidget::wheelEvent(QWheelEvent *event)
 	params_->limits.zoom(in, xw, yw);
 	settingsWidget_->changeZoom(params_->limits.zoomFactor());
 	updateParams();
+
+	// Show the reprojected last frame right away
+	update();
 }
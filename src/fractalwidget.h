@@ -7,7 +7,9 @@
 #define FRACTALWIDGET_H
 
 #include "renderer.h"
+#include "recorder.h"
 #include <QTimer>
+#include <QPointer>
 #include <QElapsedTimer>
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions>
@@ -15,6 +17,7 @@
 
 struct Parameters;
 class SettingsWidget;
+class QProgressDialog;
 
 enum DraggingMode : quint8 { NoDragging, DraggingRoot, DraggingFractal };
 
@@ -37,10 +40,15 @@ public:
 	void reset();
 
 public slots:
-	void updateFractal(const QPixmap &pixmap, double fps);
+	void updateFractal(const QPixmap &pixmap, const Limits &limits, double fps, bool partial);
 	void updateOrbit(const QVector<QPoint> &orbit, double fps);
 	void runBenchmark();
 	void finishBenchmark(const QImage *image);
+	void appendKeyframe();
+	void toggleRecording();
+	void replaySession();
+	void finishReplay(const QString &report);
+	void calibrate();
 
 protected:
 	void enable(bool value);
@@ -55,6 +63,7 @@ protected:
 private:
 	bool enabled_;
 	QPixmap pixmap_;
+	Limits pixmapLimits_;
 	QTimer scaleDownTimer_;
 	QElapsedTimer benchmarkTimer_;
 	QVector<QPoint> orbit_;
@@ -62,6 +71,8 @@ private:
 	SettingsWidget *settingsWidget_;
 	QOpenGLShaderProgram *program_;
 	Renderer renderer_;
+	Recorder recorder_;
+	QPointer<QProgressDialog> exportProgress_;
 	Dragger dragger_;
 	double fps_;
 	bool legend_;
@@ -0,0 +1,111 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "framewriter.h"
+#include <QDir>
+#include <cstdio>
+
+FrameWriter::FrameWriter() :
+	y4m_(false),
+	index_(0)
+{
+}
+
+FrameWriter::~FrameWriter()
+{
+	// Close file if open
+	close();
+}
+
+bool FrameWriter::open(const QString &output, QSize size, int fps)
+{
+	// Static Y4M stream header (4:4:4 so odd sizes work)
+	static const QString header = "YUV4MPEG2 W%1 H%2 F%3:1 Ip A1:1 C444\n";
+
+	// Raw Y4M stream to file or stdout
+	index_ = 0;
+	size_ = size;
+	y4m_ = output == "-" || output.endsWith(".y4m");
+	if (y4m_) {
+		bool opened = false;
+		if (output == "-") {
+			opened = file_.open(stdout, QIODevice::WriteOnly);
+		} else {
+			file_.setFileName(output);
+			opened = file_.open(QIODevice::WriteOnly | QIODevice::Truncate);
+		}
+		if (!opened) {
+			error_ = file_.errorString();
+			return false;
+		}
+		planes_.resize(3 * size.width() * size.height());
+		return file_.write(header.arg(size.width()).arg(size.height()).arg(fps).toLatin1()) > 0;
+	}
+
+	// Else PNG sequence in directory
+	dir_ = output;
+	if (!QDir().mkpath(dir_)) {
+		error_ = "Could not create directory " + dir_;
+		return false;
+	}
+	return true;
+}
+
+bool FrameWriter::write(const QImage &image)
+{
+	// Write PNG
+	if (!y4m_) {
+		QString name = QString("%1/frame_%2.png").arg(dir_).arg(index_++, 5, 10, QChar('0'));
+		if (!image.save(name, "PNG")) {
+			error_ = "Could not write " + name;
+			return false;
+		}
+		return true;
+	}
+
+	// Convert RGB to BT.601 limited range YUV planes
+	const int pixels = size_.width() * size_.height();
+	uchar *yp = reinterpret_cast<uchar*>(planes_.data());
+	uchar *up = yp + pixels;
+	uchar *vp = up + pixels;
+	for (int y = 0; y < size_.height(); ++y) {
+		const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+		for (int x = 0; x < size_.width(); ++x) {
+			int r = qRed(line[x]), g = qGreen(line[x]), b = qBlue(line[x]);
+			*yp++ = static_cast<uchar>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+			*up++ = static_cast<uchar>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+			*vp++ = static_cast<uchar>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+		}
+	}
+
+	// Write frame
+	++index_;
+	if (file_.write("FRAME\n", 6) != 6 || file_.write(planes_) != planes_.size()) {
+		error_ = file_.errorString();
+		return false;
+	}
+	return true;
+}
+
+void FrameWriter::close()
+{
+	// Close stream
+	if (file_.isOpen()) {
+		file_.flush();
+		file_.close();
+	}
+}
+
+int FrameWriter::frameCount() const
+{
+	// Return number of written frames
+	return index_;
+}
+
+QString FrameWriter::errorString() const
+{
+	// Return last error
+	return error_;
+}
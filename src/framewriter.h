@@ -0,0 +1,35 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef FRAMEWRITER_H
+#define FRAMEWRITER_H
+
+#include <QFile>
+#include <QSize>
+#include <QImage>
+#include <QByteArray>
+
+class FrameWriter
+{
+public:
+	FrameWriter();
+	~FrameWriter();
+	bool open(const QString &output, QSize size, int fps);
+	bool write(const QImage &image);
+	void close();
+	int frameCount() const;
+	QString errorString() const;
+
+private:
+	bool y4m_;
+	int index_;
+	QSize size_;
+	QString dir_;
+	QString error_;
+	QFile file_;
+	QByteArray planes_;
+};
+
+#endif // FRAMEWRITER_H
@@ -0,0 +1,71 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "governor.h"
+#include <QString>
+#include <cmath>
+
+FrameGovernor::FrameGovernor() :
+	last_({nf::DSC, nf::DMI}),
+	cost_(0),
+	depth_(0)
+{
+	// Nothing measured yet
+	resetStats();
+}
+
+FrameBudget FrameGovernor::budget(const Parameters &params)
+{
+	// Static settings until the first preview was measured
+	const FrameBudget fixed = {params.scaleDownFactor, params.maxIterations};
+	if (params.frameTime == 0 || cost_ <= 0 || depth_ <= 0) return last_ = fixed;
+
+	// Iterations per pixel are assumed to grow linearly with the cap (true at worst)
+	const double work = params.frameTime / cost_;
+	const double pixels = double(params.size.width()) * params.size.height();
+	FrameBudget next = fixed;
+	next.scale = qBound(nf::GMS, sqrt(work / (pixels * depth_ * params.maxIterations)), 1.0);
+
+	// Smallest preview is still too slow -> cap the iterations as well
+	const double cap = work / (pixels * next.scale * next.scale * depth_);
+	if (next.scale <= nf::GMS && cap < params.maxIterations) next.iterations = qMin(double(params.maxIterations), qMax(double(nf::GMI), cap));
+	return last_ = next;
+}
+
+void FrameGovernor::measure(const Parameters &params, qint64 pixels, quint64 iterations, double elapsed)
+{
+	// Lines from the cache cost nothing and tell nothing
+	if (pixels <= 0 || iterations == 0 || elapsed <= 0) return;
+	const double cost = elapsed / iterations;
+	cost_ = cost_ <= 0 ? cost : cost_ + nf::GSA * (cost - cost_);
+	depth_ = double(iterations) / pixels / qMax(quint16(1), last_.iterations);
+
+	// Statistics of the previews
+	++frames_;
+	if (elapsed <= params.frameTime) ++onTime_;
+	scaleSum_ += last_.scale;
+	iterationSum_ += last_.iterations;
+}
+
+void FrameGovernor::resetStats()
+{
+	// Reset counters
+	frames_ = onTime_ = 0;
+	scaleSum_ = iterationSum_ = 0;
+}
+
+QString FrameGovernor::report() const
+{
+	// Static output string
+	static const QString out = "Frame governor: %1 of %2 previews within the target frame time (%3 %), "
+		"mean scale %4 %, mean iteration cap %5";
+
+	// Averages
+	const double frames = qMax(qint64(1), frames_);
+	return out.arg(onTime_).arg(frames_)
+		.arg(100.0 * onTime_ / frames, 0, 'f', 1)
+		.arg(100.0 * scaleSum_ / frames, 0, 'f', 1)
+		.arg(iterationSum_ / frames, 0, 'f', 0);
+}
@@ -0,0 +1,39 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include "parameters.h"
+
+struct FrameBudget {
+	double scale;
+	quint16 iterations;
+};
+
+// Keeps interactive previews at the target frame time of the parameters: the measured
+// cost per iteration predicts how many iterations fit into the next frame. Resolution
+// goes first (down to nf::GMS), then the iteration cap (down to nf::GMI). A target of
+// 0 keeps the static scaledown factor. Settled frames never ask for a budget.
+class FrameGovernor
+{
+public:
+	FrameGovernor();
+	FrameBudget budget(const Parameters &params);
+	void measure(const Parameters &params, qint64 pixels, quint64 iterations, double elapsed);
+	void resetStats();
+	QString report() const;
+
+private:
+	FrameBudget last_;
+	double cost_;
+	double depth_;
+	qint64 frames_;
+	qint64 onTime_;
+	double scaleSum_;
+	double iterationSum_;
+};
+
+#endif // GOVERNOR_H
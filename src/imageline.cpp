@@ -4,8 +4,35 @@
 // see the file LICENSE in the main directory.
 
 #include "imageline.h"
+#include <algorithm>
 
-ImageLine::ImageLine()
+KernelStats::KernelStats() :
+	iterations(0),
+	estimated(0),
+	saved(0),
+	capped(0),
+	certified(0)
+{
+	// Empty histogram
+	std::fill(histogram, histogram + nf::HGB, 0);
+}
+
+KernelStats &KernelStats::operator+=(const KernelStats &other)
+{
+	// Sum up counters
+	iterations += other.iterations;
+	estimated += other.estimated;
+	saved += other.saved;
+	capped += other.capped;
+	certified += other.certified;
+	for (int b = 0; b < nf::HGB; ++b) histogram[b] += other.histogram[b];
+	return *this;
+}
+
+ImageLine::ImageLine() :
+	plan(nullptr),
+	states(nullptr),
+	basins(nullptr)
 {
 }
 
@@ -15,7 +42,11 @@ ImageLine::ImageLine(QRgb *scanLine, int lineIndex, int lineSize, const Paramete
 	lineSize(lineSize),
 	zx(0),
 	zy(0),
-	params(params)
+	hx(0),
+	params(params),
+	plan(nullptr),
+	states(nullptr),
+	basins(nullptr)
 {
 }
 
@@ -25,7 +56,13 @@ ImageLine::ImageLine(const ImageLine &other) :
 	lineSize(other.lineSize),
 	zx(other.zx),
 	zy(other.zy),
-	params(other.params)
+	hx(other.hx),
+	params(other.params),
+	plan(other.plan),
+	stats(other.stats),
+	states(other.states),
+	basins(other.basins),
+	resume(other.resume)
 {
 }
 
@@ -37,6 +74,21 @@ ImageLine &ImageLine::operator=(const ImageLine &other)
 	lineSize = other.lineSize;
 	zx = other.zx;
 	zy = other.zy;
+	hx = other.hx;
 	params = other.params;
+	plan = other.plan;
+	stats = other.stats;
+	states = other.states;
+	basins = other.basins;
+	resume = other.resume;
 	return *this;
 }
+
+ImageTile::ImageTile() :
+	distance(0),
+	deepen(false),
+	certify(false),
+	basins(nullptr),
+	done(0)
+{
+}
@@ -7,8 +7,55 @@
 #define IMAGELINE_H
 
 #include "parameters.h"
+#include "fastcomplex.h"
+#include <QAtomicInt>
+#include <QVector>
+#include <QRect>
 #include <QRgb>
 
+struct KernelPlan;
+class BasinMap;
+
+struct KernelStats {
+	KernelStats();
+	KernelStats &operator+=(const KernelStats &other);
+	void converged(quint16 i, quint16 maxIterations);
+	qint64 iterations;
+	qint64 estimated;
+	qint64 saved;
+	qint64 capped;
+	qint64 certified;
+	qint64 histogram[nf::HGB];
+};
+
+inline void KernelStats::converged(quint16 i, quint16 maxIterations)
+{
+	// Iterations to converge in nf::HGB buckets up to the cap
+	++histogram[i * nf::HGB / maxIterations];
+}
+
+enum OrbitEnd : qint16 { OrbitEscaped = -1, OrbitCapped = -2 };
+
+struct OrbitState {
+	fcomplex z;
+	fcomplex saved;
+	quint32 power;
+	quint32 period;
+	quint16 iterations;
+	qint16 root;
+	bool inside;
+};
+
+struct PixelState {
+	quint16 iterations;
+	qint16 root;
+};
+
+struct ResumePoint {
+	int x;
+	OrbitState state;
+};
+
 struct ImageLine {
 	ImageLine();
 	ImageLine(QRgb *scanLine, int lineIndex, int lineSize, const Parameters *params);
@@ -19,7 +66,25 @@ struct ImageLine {
 	int lineSize;
 	double zx;
 	double zy;
+	double hx;
 	const Parameters *params;
+	const KernelPlan *plan;
+	KernelStats stats;
+	PixelState *states;
+	const BasinMap *basins;
+	QVector<ResumePoint> resume;
+};
+
+struct ImageTile {
+	ImageTile();
+	QRect rect;
+	double distance;
+	Parameters params;
+	QVector<ImageLine> lines;
+	bool deepen;
+	bool certify;
+	BasinMap *basins;
+	QAtomicInt done;
 };
 
 #endif // IMAGELINE_H
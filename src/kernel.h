@@ -0,0 +1,386 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include "imageline.h"
+#include "basinmap.h"
+#include "largekernel.h"
+#include "fastcomplex.h"
+#include <QSharedPointer>
+#include <cmath>
+#include <limits>
+
+inline void func(fcomplex z, fcomplex &f, fcomplex &df, const fcomplex *roots, int rootCount)
+{
+	// Calculate f and derivative with given roots
+	if (rootCount < 2) return;
+
+	// TODO: algorithm documentation
+	fcomplex r = (z - roots[0]);
+	fcomplex l = (z - roots[1]);
+	for (int i = 1; i < rootCount - 1; ++i) {
+		l = (z - roots[i + 1]) * (l + r);
+		r *= (z - roots[i]);
+	}
+	df = l + r;
+	f = r * (z - roots[rootCount - 1]);
+}
+
+inline void derivatives(fcomplex z, fcomplex &f, fcomplex &df, fcomplex &ddf, fcomplex &dddf, const fcomplex *roots, int rootCount)
+{
+	// Multiply in one root after another and apply the product rule to every derivative
+	f = 1;
+	df = ddf = dddf = 0;
+	for (int i = 0; i < rootCount; ++i) {
+		fcomplex w = z - roots[i];
+		dddf = dddf * w + 3.0 * ddf;
+		ddf = ddf * w + 2.0 * df;
+		df = df * w + f;
+		f *= w;
+	}
+}
+
+inline QVector<fcomplex> rootValues(const Parameters &params)
+{
+	// Root values in the kernel's complex type
+	QVector<fcomplex> values;
+	values.reserve(params.roots.count());
+	for (const Root &root : params.roots) values.append(root.value());
+	return values;
+}
+
+inline fcomplex methodStep(fcomplex z, const Parameters *params, const QVector<fcomplex> &roots)
+{
+	// Newton only needs f and f'
+	const fcomplex d = params->damping;
+	fcomplex f, df, ddf, dddf;
+	if (params->method == NEWTON) {
+		func(z, f, df, roots.constData(), roots.count());
+		return d * f / df;
+	}
+
+	// Higher order methods
+	derivatives(z, f, df, ddf, dddf, roots.constData(), roots.count());
+	switch (params->method) {
+	case HALLEY: return d * 2.0 * f * df / (2.0 * df * df - f * ddf);
+	case HOUSEHOLDER: return d * (6.0 * f * df * df - 3.0 * f * f * ddf) / (6.0 * df * df * df - 6.0 * f * df * ddf + f * f * dddf);
+	case SCHROEDER: return d * f * df / (df * df - f * ddf);
+	default: return d * f / df;
+	}
+}
+
+inline double multiplicity(fcomplex z, const QVector<RootCluster> &clusters, bool &inside)
+{
+	// Seen from outside a few spreads a cluster acts like one root with multiplicity m
+	// -> z - m f / f' converges quadratically again instead of linearly
+	// Inside, plain steps separate the members (sets inside to never jump out again)
+	for (const RootCluster &cluster : clusters) {
+		double dist = norm(z - fcomplex(cluster.center));
+		if (dist <= nf::CSF * nf::CSF * cluster.spread * cluster.spread) inside = true;
+		else if (dist < cluster.reach * cluster.reach) return cluster.multiplicity;
+	}
+	return 1;
+}
+
+struct CaptureDisk {
+	fcomplex root;
+	fcomplex sum;
+	fcomplex sum2;
+	double sum3;
+	double radius;
+};
+
+enum Precision : quint8 { DoublePrecision, FloatPrecision };
+
+struct KernelPlan {
+	Precision precision = DoublePrecision;
+	int lanes = nf::FPL;
+	QVector<fcomplex> roots;
+	QVector<QRgb> palette;
+	QVector<CaptureDisk> disks;
+	QVector<RootCluster> clusters;
+	QSharedPointer<const LargeKernel> large;
+	QVector<float> rootsRe;
+	QVector<float> rootsIm;
+};
+
+inline QVector<QRgb> createPalette(const Parameters &params)
+{
+	// Precompute shaded root colors for every iteration count
+	const int rootCount = params.roots.count();
+	QVector<QRgb> palette(rootCount * params.maxIterations);
+	for (int r = 0; r < rootCount; ++r) {
+		for (quint16 i = 0; i < params.maxIterations; ++i) {
+			palette[r * params.maxIterations + i] = params.roots[r].color().darker(60 + i * 8).rgb();
+		}
+	}
+	return palette;
+}
+
+inline QVector<CaptureDisk> createCaptureDisks(const Parameters &params)
+{
+	// Tile certification: near root k the damped step is e' = e (1 - d + e S') / (1 + e S') with e = z - r_k
+	// and S' = sum 1 / (z - r_j), j != k. With delta = distance to the nearest other root
+	// and |e| < R = q delta / (n - 1 + q) follows |e S'| < q, so for q = (1 - |1 - d|) / 2
+	// the error shrinks every step and the orbit can never leave the disk again (Newton only)
+	// S' = sum + e sum2 + R with |R| <= |e|^2 sum3 / (1 - |e| / delta) < 1.5 |e|^2 sum3 in the disk
+	// Roots closer than 2 EPS get none, the convergence test could pick the other root first
+	const int rootCount = params.roots.count();
+	const double q = 0.5 * (1 - abs(1.0 - params.damping));
+	QVector<CaptureDisk> disks(rootCount);
+	for (int k = 0; k < rootCount; ++k) {
+		CaptureDisk &disk = disks[k];
+		double delta = std::numeric_limits<double>::max();
+		disk.root = params.roots[k].value();
+		disk.sum = 0;
+		disk.sum2 = 0;
+		disk.sum3 = 0;
+		for (int j = 0; j < rootCount; ++j) {
+			if (j == k) continue;
+			fcomplex diff = disk.root - fcomplex(params.roots[j].value());
+			delta = qMin(delta, abs(diff));
+			if (diff != fcomplex(0)) {
+				disk.sum += 1.0 / diff;
+				disk.sum2 -= 1.0 / (diff * diff);
+				disk.sum3 += 1.0 / (abs(diff) * norm(diff));
+			}
+		}
+		disk.radius = q > 0 && rootCount > 1 && params.method == NEWTON && delta >= 2 * nf::EPS ? q * delta / (rootCount - 1 + q) : 0;
+	}
+	return disks;
+}
+
+inline KernelPlan createPlan(const Parameters &params, const QVector<QRgb> &palette)
+{
+	// Per-frame setup shared by all pixels, the palette may be shared by plans of the same colors
+	KernelPlan plan;
+	plan.roots = rootValues(params);
+	plan.palette = palette;
+	if (params.roots.count() > nf::MRC) {
+		plan.large.reset(new LargeKernel(params, params.roots.count() >= nf::FMT));
+		return plan;
+	}
+	plan.disks = createCaptureDisks(params);
+	if (params.method == NEWTON) plan.clusters = params.rootClusters();
+	return plan;
+}
+
+inline KernelPlan createPlan(const Parameters &params)
+{
+	// Plan with its own palette
+	return createPlan(params, createPalette(params));
+}
+
+inline QRgb iterateLarge(fcomplex z, const Parameters *params, const KernelPlan &plan, KernelStats *stats)
+{
+	// Same iteration as below with O(n) steps and grid classification
+	const LargeKernel &large = *plan.large;
+	fcomplex saved = z;
+	quint32 power = 1, period = 0;
+	for (quint16 i = 0; i < params->maxIterations; ++i) {
+		fcomplex z0 = z - fcomplex(large.step(z));
+		double step = norm(z0 - z);
+
+		// If root has been found return color
+		if (step < nf::EPS * nf::EPS) {
+			int r = large.rootAt(z0);
+			if (r >= 0) {
+				if (stats) {
+					stats->iterations += i + 1;
+					stats->converged(i, params->maxIterations);
+				}
+				return plan.palette[r * params->maxIterations + i];
+			}
+		}
+
+		// Blown up, escaped or attracting cycle
+		bool diverged = !std::isfinite(z0.real()) || !std::isfinite(z0.imag()) || norm(z0) > nf::ESR * nf::ESR;
+		bool cycle = step >= nf::EPS * nf::EPS && norm(z0 - saved) < nf::EPS * nf::EPS * nf::EPS * nf::EPS;
+		if (diverged || cycle) {
+			if (stats) {
+				stats->iterations += i + 1;
+				stats->saved += params->maxIterations - i - 1;
+			}
+			return nf::NCC.rgb();
+		}
+		if (++period == power) {
+			saved = z0;
+			power *= 2;
+			period = 0;
+		}
+		z = z0;
+	}
+
+	// No root -> black
+	if (stats) {
+		stats->iterations += params->maxIterations;
+		++stats->capped;
+	}
+	return qRgb(0, 0, 0);
+}
+
+inline QRgb iterateOrbit(OrbitState &orbit, const Parameters *params, const KernelPlan &plan, KernelStats *stats, const BasinMap *basins = nullptr)
+{
+	// Brent cycle detection: compare against a saved point, double the period every time it is reached
+	// Starts at orbit.iterations and leaves the outcome (root or OrbitEnd) in orbit
+	const int rootCount = plan.roots.count();
+	const quint16 start = orbit.iterations;
+	fcomplex z = orbit.z;
+	fcomplex saved = orbit.saved;
+	quint32 power = orbit.power, period = orbit.period;
+	bool inside = orbit.inside;
+	for (quint16 i = start; i < params->maxIterations; ++i) {
+
+		// Landed inside a uniform basin of a finished tile -> its root, its iterations on top (approximate)
+		const PixelState *known = basins && i > start ? basins->lookup(z) : nullptr;
+		if (known != nullptr) {
+			const int n = i + known->iterations;
+			if (stats) {
+				stats->iterations += i - start;
+				stats->estimated += known->iterations;
+				stats->saved += known->iterations;
+				if (n < params->maxIterations) stats->converged(n, params->maxIterations);
+				else ++stats->capped;
+			}
+			if (n >= params->maxIterations) {
+				orbit = {z, saved, power, period, i, OrbitCapped, inside};
+				return qRgb(0, 0, 0);
+			}
+			orbit.iterations = n;
+			orbit.root = known->root;
+			return plan.palette[known->root * params->maxIterations + n];
+		}
+
+		fcomplex dz = methodStep(z, params, plan.roots); // <- one reciprocal
+		if (!inside) dz *= multiplicity(z, plan.clusters, inside);
+		fcomplex z0 = z - dz;
+		double step = norm(dz);
+
+		// If root has been found return color
+		if (step < nf::EPS * nf::EPS) {
+			for (int r = 0; r < rootCount; ++r) {
+				if (norm(z0 - plan.roots[r]) < nf::EPS * nf::EPS) {
+					if (stats) {
+						stats->iterations += i + 1 - start;
+						stats->converged(i, params->maxIterations);
+					}
+					orbit.iterations = i;
+					orbit.root = r;
+					return plan.palette[r * params->maxIterations + i];
+				}
+			}
+		}
+
+		// Blown up (df = 0, NaN / Inf) or escaped -> no root will be reached
+		// Orbit moves but returned to saved point -> attracting cycle
+		bool diverged = !std::isfinite(z0.real()) || !std::isfinite(z0.imag()) || norm(z0) > nf::ESR * nf::ESR;
+		bool cycle = step >= nf::EPS * nf::EPS && norm(z0 - saved) < nf::EPS * nf::EPS * nf::EPS * nf::EPS;
+		if (diverged || cycle) {
+			if (stats) {
+				stats->iterations += i + 1 - start;
+				stats->saved += params->maxIterations - i - 1;
+			}
+			orbit.iterations = i;
+			orbit.root = OrbitEscaped;
+			return nf::NCC.rgb();
+		}
+		if (++period == power) {
+			saved = z0;
+			power *= 2;
+			period = 0;
+		}
+		z = z0;
+	}
+
+	// No root -> black, keep the state to resume from with a larger cap
+	if (stats) {
+		stats->iterations += params->maxIterations - start;
+		++stats->capped;
+	}
+	orbit = {z, saved, power, period, params->maxIterations, OrbitCapped, inside};
+	return qRgb(0, 0, 0);
+}
+
+inline OrbitState startOrbit(fcomplex z, const KernelPlan &plan)
+{
+	// Fresh orbit at z
+	return {z, z, 1, 0, 0, OrbitCapped, plan.clusters.isEmpty()};
+}
+
+inline QRgb iteratePoint(fcomplex z, const Parameters *params, const KernelPlan &plan, KernelStats *stats = nullptr)
+{
+	// More than nf::MRC roots -> large degree engine
+	if (plan.large) return iterateLarge(z, params, plan, stats);
+	OrbitState orbit = startOrbit(z, plan);
+	return iterateOrbit(orbit, params, plan, stats);
+}
+
+inline void iterateSpan(ImageLine &il, int from, int to)
+{
+	// Iterate the x-pixels from..to-1
+	const double left = il.params->limits.left();
+	const double xFactor = il.hx;
+	for (int x = from; x < to; ++x) {
+
+		// Create complex number from current pixel
+		il.zx = x * xFactor + left;
+		if (il.states == nullptr) {
+			il.scanLine[x] = iteratePoint(fcomplex(il.zx, il.zy), il.params, *il.plan, &il.stats);
+			continue;
+		}
+
+		// Keep the outcome for other caps, the orbit too if it ran into this one
+		OrbitState orbit = startOrbit(fcomplex(il.zx, il.zy), *il.plan);
+		il.scanLine[x] = iterateOrbit(orbit, il.params, *il.plan, &il.stats, il.basins);
+		il.states[x] = {orbit.iterations, orbit.root};
+		if (orbit.root == OrbitCapped) il.resume.append({x, orbit});
+	}
+}
+
+inline void iterateX(ImageLine &il)
+{
+	// Iterate x-pixels
+	iterateSpan(il, 0, il.lineSize);
+}
+
+inline void deepenX(ImageLine &il)
+{
+	// Recolor pixels with a known outcome for the new cap
+	const Parameters *params = il.params;
+	const KernelPlan &plan = *il.plan;
+	const quint16 maxIterations = params->maxIterations;
+	for (int x = 0; x < il.lineSize; ++x) {
+		const PixelState &state = il.states[x];
+		if (state.root == OrbitCapped) continue;
+		if (state.iterations >= maxIterations) {
+			il.scanLine[x] = qRgb(0, 0, 0);
+			++il.stats.capped;
+		} else if (state.root == OrbitEscaped) {
+			il.scanLine[x] = nf::NCC.rgb();
+		} else {
+			il.scanLine[x] = plan.palette[state.root * maxIterations + state.iterations];
+			il.stats.converged(state.iterations, maxIterations);
+		}
+	}
+
+	// Resume the orbits that ran into the old cap, keep the ones that run into the new one
+	int kept = 0;
+	for (int i = 0; i < il.resume.count(); ++i) {
+		ResumePoint point = il.resume[i];
+		if (point.state.iterations < maxIterations) {
+			il.scanLine[point.x] = iterateOrbit(point.state, params, plan, &il.stats);
+			il.states[point.x] = {point.state.iterations, point.state.root};
+		} else {
+			il.scanLine[point.x] = qRgb(0, 0, 0);
+			++il.stats.capped;
+		}
+		if (point.state.root == OrbitCapped) il.resume[kept++] = point;
+	}
+	il.resume.resize(kept);
+}
+
+#endif // KERNEL_H
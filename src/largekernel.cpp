@@ -0,0 +1,212 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "largekernel.h"
+#include <cmath>
+
+LargeKernel::LargeKernel(const Parameters &params, bool farField) :
+	damping_(params.damping),
+	method_(params.method),
+	farField_(farField && params.method == NEWTON),
+	order_(params.method == NEWTON ? 1 : params.method == HOUSEHOLDER ? 3 : 2),
+	cellSize_(nf::EPS),
+	gridWidth_(1),
+	gridHeight_(1)
+{
+	// Bounding box of all roots
+	const int rootCount = params.roots.count();
+	double left = 0, right = 0, top = 0, bottom = 0;
+	for (int i = 0; i < rootCount; ++i) {
+		complex r = params.roots[i].value();
+		left = i == 0 ? r.real() : qMin(left, r.real());
+		right = i == 0 ? r.real() : qMax(right, r.real());
+		bottom = i == 0 ? r.imag() : qMin(bottom, r.imag());
+		top = i == 0 ? r.imag() : qMax(top, r.imag());
+	}
+
+	// Square cells with a few roots each, more for the far field to balance near and far cells
+	// Cells are never smaller than nf::EPS so classification only needs the 3x3 neighbourhood
+	double perCell = farField_ ? qMax(double(nf::RPC), 0.5 * sqrt(double(rootCount) * nf::FMP)) : nf::RPC;
+	double extent = qMax(qMax(right - left, top - bottom), nf::EPS);
+	cellSize_ = qMax(nf::EPS, extent / qMax(1.0, sqrt(rootCount / perCell)));
+	gridWidth_ = static_cast<int>((right - left) / cellSize_) + 1;
+	gridHeight_ = static_cast<int>((top - bottom) / cellSize_) + 1;
+	gridOrigin_ = complex(left, bottom);
+
+	// Sort roots by cell (counting sort) into SoA arrays
+	QVector<int> rootCell(rootCount);
+	QVector<int> counts(gridWidth_ * gridHeight_ + 1, 0);
+	for (int i = 0; i < rootCount; ++i) {
+		int cx, cy;
+		rootCell[i] = cellIndex(params.roots[i].value(), cx, cy);
+		++counts[rootCell[i] + 1];
+	}
+	for (int c = 1; c < counts.count(); ++c) counts[c] += counts[c - 1];
+	cells_.resize(gridWidth_ * gridHeight_);
+	for (int c = 0; c < cells_.count(); ++c) {
+		cells_[c].first = counts[c];
+		cells_[c].count = 0;
+	}
+	re_.resize(rootCount);
+	im_.resize(rootCount);
+	index_.resize(rootCount);
+	for (int i = 0; i < rootCount; ++i) {
+		Cell &cell = cells_[rootCell[i]];
+		int k = cell.first + cell.count++;
+		re_[k] = params.roots[i].value().real();
+		im_[k] = params.roots[i].value().imag();
+		index_[k] = i;
+	}
+
+	// Far-field moments a_k = sum (r_i - c)^k around each cell center
+	for (int c = 0; c < cells_.count(); ++c) {
+		Cell &cell = cells_[c];
+		cell.center = gridOrigin_ + complex((c % gridWidth_ + 0.5) * cellSize_, (c / gridWidth_ + 0.5) * cellSize_);
+		cell.radius = 0;
+		for (int k = 0; k < nf::FMP; ++k) cell.moments[k] = 0;
+		for (int i = cell.first; i < cell.first + cell.count; ++i) {
+			complex d = complex(re_[i], im_[i]) - cell.center;
+			complex p = 1;
+			cell.radius = qMax(cell.radius, abs(d));
+			for (int k = 0; k < nf::FMP; ++k) {
+				cell.moments[k] += p;
+				p *= d;
+			}
+		}
+	}
+}
+
+complex LargeKernel::step(complex z) const
+{
+	// Newton: f / f' = 1 / S1
+	if (order_ == 1) {
+		complex s1;
+		if (farField_) s1 = farFieldSum(z);
+		else directSums(z, 0, re_.count(), &s1, 1);
+		return damping_ / s1;
+	}
+
+	// Higher derivatives from S_k = sum 1 / (z - r_i)^k:
+	// f' / f = S1, f'' / f = S1^2 - S2, f''' / f = S1^3 - 3 S1 S2 + 2 S3
+	complex s[3];
+	directSums(z, 0, re_.count(), s, order_);
+	complex a = s[0] * s[0] - s[1];
+	switch (method_) {
+	case HALLEY: return damping_ * 2.0 * s[0] / (s[0] * s[0] + s[1]);
+	case SCHROEDER: return damping_ * s[0] / s[1];
+	default: {
+		complex b = s[0] * s[0] * s[0] - 3.0 * s[0] * s[1] + 2.0 * s[2];
+		return damping_ * (6.0 * s[0] * s[0] - 3.0 * a) / (6.0 * s[0] * s[0] * s[0] - 6.0 * s[0] * a + b);
+	}
+	}
+}
+
+int LargeKernel::rootAt(complex z) const
+{
+	// Search the cell of z and its neighbours for a root closer than nf::EPS
+	int cx, cy;
+	cellIndex(z, cx, cy);
+	for (int y = qMax(0, cy - 1); y <= qMin(gridHeight_ - 1, cy + 1); ++y) {
+		for (int x = qMax(0, cx - 1); x <= qMin(gridWidth_ - 1, cx + 1); ++x) {
+			const Cell &cell = cells_[y * gridWidth_ + x];
+			for (int i = cell.first; i < cell.first + cell.count; ++i) {
+				double dr = z.real() - re_[i], di = z.imag() - im_[i];
+				if (dr * dr + di * di < nf::EPS * nf::EPS) return index_[i];
+			}
+		}
+	}
+	return -1;
+}
+
+bool LargeKernel::farField() const
+{
+	// Return whether far cells use far-field expansions
+	return farField_;
+}
+
+int LargeKernel::cellCount() const
+{
+	// Return number of grid cells
+	return cells_.count();
+}
+
+void LargeKernel::directSums(complex z, int first, int count, complex *sums, int order) const
+{
+	// Independent accumulators per lane so the compiler can vectorize across roots
+	static constexpr int lanes = 4;
+	const double *re = re_.constData() + first;
+	const double *im = im_.constData() + first;
+	const double zr = z.real(), zi = z.imag();
+	const int end = count - count % lanes;
+	if (order == 1) {
+		double sr[lanes] = { 0 }, si[lanes] = { 0 };
+		for (int i = 0; i < end; i += lanes) {
+			for (int l = 0; l < lanes; ++l) {
+				double wr = zr - re[i + l], wi = zi - im[i + l];
+				double inv = 1.0 / (wr * wr + wi * wi);
+				sr[l] += wr * inv;
+				si[l] -= wi * inv;
+			}
+		}
+		for (int i = end; i < count; ++i) {
+			double wr = zr - re[i], wi = zi - im[i];
+			double inv = 1.0 / (wr * wr + wi * wi);
+			sr[0] += wr * inv;
+			si[0] -= wi * inv;
+		}
+		sums[0] = complex((sr[0] + sr[1]) + (sr[2] + sr[3]), (si[0] + si[1]) + (si[2] + si[3]));
+		return;
+	}
+
+	// Powers of 1 / (z - r_i) up to the given order
+	for (int k = 0; k < order; ++k) sums[k] = 0;
+	for (int i = 0; i < count; ++i) {
+		double wr = zr - re[i], wi = zi - im[i];
+		double inv = 1.0 / (wr * wr + wi * wi);
+		complex u(wr * inv, -wi * inv);
+		complex p = u;
+		for (int k = 0; k < order; ++k) {
+			sums[k] += p;
+			p *= u;
+		}
+	}
+}
+
+complex LargeKernel::farFieldSum(complex z) const
+{
+	// Far cells of the grid (one level): sum 1 / (z - r_i) = sum_k a_k / (z - c)^(k + 1), near cells directly
+	// Plain doubles since std::complex multiplication checks for NaN / Inf
+	double sr = 0, si = 0;
+	for (const Cell &cell : cells_) {
+		if (cell.count == 0) continue;
+		double dr = z.real() - cell.center.real(), di = z.imag() - cell.center.imag();
+		double dd = dr * dr + di * di;
+		if (dd > nf::FMS * nf::FMS * cell.radius * cell.radius) {
+			double ur = dr / dd, ui = -di / dd;
+			double ar = cell.moments[nf::FMP - 1].real(), ai = cell.moments[nf::FMP - 1].imag();
+			for (int k = nf::FMP - 2; k >= 0; --k) {
+				double tr = ar * ur - ai * ui + cell.moments[k].real();
+				ai = ar * ui + ai * ur + cell.moments[k].imag();
+				ar = tr;
+			}
+			sr += ar * ur - ai * ui;
+			si += ar * ui + ai * ur;
+		} else {
+			complex near;
+			directSums(z, cell.first, cell.count, &near, 1);
+			sr += near.real();
+			si += near.imag();
+		}
+	}
+	return complex(sr, si);
+}
+
+int LargeKernel::cellIndex(complex z, int &cx, int &cy) const
+{
+	// Grid cell of z, clamped to the grid
+	cx = qBound(0, static_cast<int>(floor((z.real() - gridOrigin_.real()) / cellSize_)), gridWidth_ - 1);
+	cy = qBound(0, static_cast<int>(floor((z.imag() - gridOrigin_.imag()) / cellSize_)), gridHeight_ - 1);
+	return cy * gridWidth_ + cx;
+}
@@ -0,0 +1,55 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef LARGEKERNEL_H
+#define LARGEKERNEL_H
+
+#include "parameters.h"
+#include <QVector>
+
+// Polynomials with more than nf::MRC roots: the newton step uses the partial fraction
+// f / f' = 1 / sum 1 / (z - r_i) over roots in SoA layout and converged points are classified
+// with a spatial grid. The far-field approximation is single-level: every far cell of one grid
+// is replaced by its power series around the cell center, near cells are summed directly.
+// Cells hold about sqrt(n FMP) / 2 roots to balance both, so a step costs O(sqrt(n FMP))
+// instead of the O(log n) of a hierarchical (tree) multipole method.
+class LargeKernel
+{
+public:
+	LargeKernel(const Parameters &params, bool farField);
+	complex step(complex z) const;
+	int rootAt(complex z) const;
+	bool farField() const;
+	int cellCount() const;
+
+protected:
+	struct Cell {
+		complex center;
+		double radius;
+		int first;
+		int count;
+		complex moments[nf::FMP];
+	};
+
+	void directSums(complex z, int first, int count, complex *sums, int order) const;
+	complex farFieldSum(complex z) const;
+	int cellIndex(complex z, int &cx, int &cy) const;
+
+private:
+	complex damping_;
+	Method method_;
+	bool farField_;
+	int order_;
+	QVector<double> re_;
+	QVector<double> im_;
+	QVector<int> index_;
+	QVector<Cell> cells_;
+	complex gridOrigin_;
+	double cellSize_;
+	int gridWidth_;
+	int gridHeight_;
+};
+
+#endif // LARGEKERNEL_H
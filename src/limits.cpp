@@ -19,6 +19,19 @@ Limits::Limits(bool original) :
 	}
 }
 
+Limits::Limits(const Limits &other) :
+	left_(other.left()),
+	right_(other.right()),
+	top_(other.top()),
+	bottom_(other.bottom()),
+	original_(nullptr)
+{
+	// Deep copy original limits
+	if (other.original() != nullptr) {
+		original_ = new Limits(*other.original());
+	}
+}
+
 Limits::~Limits()
 {
 	// Delete original
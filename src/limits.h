@@ -14,6 +14,7 @@ class Limits
 {
 public:
 	Limits(bool original = false);
+	Limits(const Limits &other);
 	~Limits();
 	Limits &operator=(const Limits &other);
 	bool operator==(const Limits &other) const;
@@ -4,6 +4,7 @@
 // see the file LICENSE in the main directory.
 
 #include "fractalwidget.h"
+#include "batch.h"
 #include <QApplication>
 
 int main(int argc, char *argv[])
@@ -11,12 +12,20 @@ int main(int argc, char *argv[])
 	// Register metatype
 	qRegisterMetaType<QVector<QPoint>>("QVector<QPoint>");
 
+	// Set application info
+	QCoreApplication::setOrganizationName("inf4");
+	QCoreApplication::setOrganizationDomain("th-nuernberg.de");
+	QCoreApplication::setApplicationName("NewtonFractal");
+	QCoreApplication::setApplicationVersion(APP_VERSION);
+
+	// Run offline jobs without a window
+	if (isBatch(argc, argv)) {
+		QCoreApplication app(argc, argv);
+		return runBatch(app);
+	}
+
 	// Initialize application
 	QApplication app(argc, argv);
-	app.setOrganizationName("inf4");
-	app.setOrganizationDomain("th-nuernberg.de");
-	app.setApplicationName("NewtonFractal");
-	app.setApplicationVersion(APP_VERSION);
 
 	// Set format
 	QSurfaceFormat fmt;
@@ -5,18 +5,28 @@
 
 #include "parameters.h"
 #include <QDateTime>
+#include <QSettings>
+#include <QPair>
+#include <algorithm>
+#include <limits>
 
 Parameters::Parameters() :
 	limits(Limits()),
 	size(nf::DSI, nf::DSI),
 	maxIterations(nf::DMI),
+	autoIterations(false),
+	basinLookup(false),
+	certifyTiles(false),
 	damping(nf::DDP),
+	method(NEWTON),
 	scaleDownFactor(nf::DSC),
+	frameTime(nf::DFT),
 	scaleDown(false),
 	processor(GPU_OPENGL),
 	orbitMode(false),
 	orbitStart(0, 0),
-	benchmark(false)
+	benchmark(false),
+	antiAliasing(1)
 {
 }
 
@@ -27,7 +37,7 @@ bool Parameters::paramsChanged(const Parameters &other) const
 		return true;
 
 	// Check for same roots
-	for (quint8 i = 0; i < roots.count(); ++i) {
+	for (quint16 i = 0; i < roots.count(); ++i) {
 		if (roots[i] != other.roots[i]) {
 			return true;
 		}
@@ -38,8 +48,13 @@ bool Parameters::paramsChanged(const Parameters &other) const
 		limits != other.limits ||
 		size != other.size ||
 		maxIterations != other.maxIterations ||
+		autoIterations != other.autoIterations ||
+		basinLookup != other.basinLookup ||
+		certifyTiles != other.certifyTiles ||
 		damping != other.damping ||
+		method != other.method ||
 		scaleDownFactor != other.scaleDownFactor ||
+		frameTime != other.frameTime ||
 		scaleDown != other.scaleDown ||
 		processor != other.processor ||
 		benchmark != other.benchmark ||
@@ -67,8 +82,8 @@ void Parameters::resize(QSize newSize)
 void Parameters::reset()
 {
 	// Equidistant points on a circle
-	quint8 rootCount = roots.count();
-	for (quint8 i = 0; i < rootCount; ++i) {
+	quint16 rootCount = roots.count();
+	for (quint16 i = 0; i < rootCount; ++i) {
 		double angle = 2 * nf::PI * i / rootCount;
 		roots[i].setValue(complex(cos(angle), sin(angle)));
 	}
@@ -78,6 +93,90 @@ void Parameters::reset()
 	scaleDown = false;
 }
 
+void Parameters::save(QSettings &ini) const
+{
+	// General parameters
+	ini.beginGroup("Parameters");
+	ini.setValue("size", size);
+	ini.setValue("maxIterations", maxIterations);
+	ini.setValue("autoIterations", autoIterations);
+	ini.setValue("basinLookup", basinLookup);
+	ini.setValue("certifyTiles", certifyTiles);
+	ini.setValue("damping", complex2string(damping));
+	ini.setValue("method", static_cast<uint>(method));
+	ini.setValue("scaleDownFactor", scaleDownFactor);
+	ini.setValue("frameTime", frameTime);
+	ini.setValue("scaleDown", scaleDown);
+	ini.setValue("processor", static_cast<uint>(processor));
+	ini.setValue("orbitMode", orbitMode);
+	ini.setValue("orbitStart", orbitStart);
+	ini.endGroup();
+
+	// Limits
+	ini.beginGroup("Limits");
+	ini.setValue("left", limits.left());
+	ini.setValue("right", limits.right());
+	ini.setValue("top", limits.top());
+	ini.setValue("bottom", limits.bottom());
+	ini.setValue("left_original", limits.original()->left());
+	ini.setValue("right_original", limits.original()->right());
+	ini.setValue("top_original", limits.original()->top());
+	ini.setValue("bottom_original", limits.original()->bottom());
+	ini.endGroup();
+
+	// Roots
+	ini.beginGroup("Roots");
+	quint16 rootCount = roots.count();
+	for (quint16 i = 0; i < rootCount; ++i) {
+		ini.setValue(
+			"root" + QString::number(i),
+			complex2string(roots[i].value(), 10) + " : " + roots[i].color().name()
+		);
+	}
+	ini.endGroup();
+}
+
+void Parameters::load(QSettings &ini)
+{
+	// General parameters
+	ini.beginGroup("Parameters");
+	size = ini.value("size", QSize(nf::DSI, nf::DSI)).toSize();
+	maxIterations = ini.value("maxIterations", nf::DMI).toUInt();
+	autoIterations = ini.value("autoIterations", false).toBool();
+	basinLookup = ini.value("basinLookup", false).toBool();
+	certifyTiles = ini.value("certifyTiles", false).toBool();
+	damping = string2complex(ini.value("damping", complex2string(nf::DDP)).toString());
+	method = static_cast<Method>(qMin(ini.value("method", 0).toUInt(), static_cast<uint>(SCHROEDER)));
+	scaleDownFactor = ini.value("scaleDownFactor", nf::DSC).toDouble();
+	frameTime = ini.value("frameTime", nf::DFT).toUInt();
+	scaleDown = ini.value("scaleDown", false).toBool();
+	processor = static_cast<Processor>(ini.value("processor", 1).toUInt());
+	orbitMode = ini.value("orbitMode", false).toBool();
+	orbitStart = ini.value("orbitStart").toPoint();
+	ini.endGroup();
+
+	// Limits
+	ini.beginGroup("Limits");
+	limits.set(
+		ini.value("left", 1).toDouble(), ini.value("right", 1).toDouble(),
+		ini.value("top", 1).toDouble(), ini.value("bottom", 1).toDouble());
+	limits.setOriginal(
+		ini.value("left_original", 1).toDouble(), ini.value("right_original", 1).toDouble(),
+		ini.value("top_original", 1).toDouble(), ini.value("bottom_original", 1).toDouble());
+	ini.endGroup();
+
+	// Roots
+	roots.clear();
+	ini.beginGroup("Roots");
+	for (QString key : ini.childKeys()) {
+		QStringList str = ini.value(key).toString().split(":");
+		if (str.length() >= 2 && roots.count() < nf::MLR) {
+			roots.append(Root(string2complex(str.first()), QColor(str.last().simplified())));
+		}
+	}
+	ini.endGroup();
+}
+
 QPoint Parameters::complex2point(complex z)
 {
 	// Convert complex to point
@@ -115,6 +214,63 @@ int Parameters::rootContainsPoint(QPoint point)
 	return -1;
 }
 
+QVector<RootCluster> Parameters::rootClusters() const
+{
+	// Root pairs from the closest on (single linkage)
+	if (roots.count() > nf::MRC) return QVector<RootCluster>();
+	quint8 rootCount = roots.count();
+	QVector<int> group(rootCount);
+	QVector<QPair<double, QPoint>> pairs;
+	for (quint8 i = 0; i < rootCount; ++i) {
+		group[i] = i;
+		for (quint8 j = i + 1; j < rootCount; ++j) {
+			pairs.append(qMakePair(abs(roots[i].value() - roots[j].value()), QPoint(i, j)));
+		}
+	}
+	std::sort(pairs.begin(), pairs.end(), [](const QPair<double, QPoint> &a, const QPair<double, QPoint> &b) {
+		return a.first < b.first;
+	});
+
+	// Merge if the pair is closer than nf::CRD times the distance of the merged group to the
+	// nearest other root -> independent of zoom and scale, a group of all roots never forms
+	for (const QPair<double, QPoint> &pair : pairs) {
+		const int a = group[pair.second.x()], b = group[pair.second.y()];
+		if (a == b) continue;
+		double outside = std::numeric_limits<double>::max();
+		for (quint8 k = 0; k < rootCount; ++k) {
+			if (group[k] == a || group[k] == b) continue;
+			for (quint8 m = 0; m < rootCount; ++m) {
+				if (group[m] == a || group[m] == b) outside = qMin(outside, abs(roots[k].value() - roots[m].value()));
+			}
+		}
+		if (outside == std::numeric_limits<double>::max() || pair.first >= nf::CRD * outside) continue;
+		for (int &g : group) if (g == b) g = a;
+	}
+
+	// Describe every group with more than one root
+	QVector<RootCluster> clusters;
+	for (quint8 i = 0; i < rootCount; ++i) {
+		if (group[i] != i || group.count(i) < 2) continue;
+		RootCluster cluster;
+		cluster.center = 0;
+		cluster.spread = 0;
+		cluster.reach = std::numeric_limits<double>::max();
+		cluster.multiplicity = group.count(i);
+		for (quint8 j = 0; j < rootCount; ++j) {
+			if (group[j] == i) cluster.center += roots[j].value() / static_cast<double>(cluster.multiplicity);
+		}
+
+		// Modified step is used between a few spreads and half the way to the next root
+		for (quint8 j = 0; j < rootCount; ++j) {
+			double dist = abs(roots[j].value() - cluster.center);
+			if (group[j] == i) cluster.spread = qMax(cluster.spread, dist);
+			else cluster.reach = qMin(cluster.reach, 0.5 * dist);
+		}
+		clusters.append(cluster);
+	}
+	return clusters;
+}
+
 QVector<QVector2D> Parameters::rootsVec2()
 {
 	// Return vector of root values only
@@ -165,6 +321,14 @@ complex string2complex(const QString &text)
 	return (complex(real, imag));
 }
 
+QSize string2size(const QString &text, QSize fallback)
+{
+	// Convert "<width>x<height>" to size
+	QStringList parts = text.split('x');
+	QSize size(parts.first().toInt(), parts.last().toInt());
+	return parts.length() == 2 && size.width() > 1 && size.height() > 1 ? size : fallback;
+}
+
 QString complex2string(complex z, quint8 precision)
 {
 	// Convert complex to string
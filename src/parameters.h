@@ -14,23 +14,42 @@
 #include <QVector2D>
 #include <QVector3D>
 
+class QSettings;
+
 enum Processor {
 	CPU_SINGLE,
 	CPU_MULTI,
 	GPU_OPENGL
 };
 
+enum Method {
+	NEWTON,
+	HALLEY,
+	HOUSEHOLDER,
+	SCHROEDER
+};
+
+struct RootCluster {
+	complex center;
+	double spread;
+	double reach;
+	quint8 multiplicity;
+};
+
 struct Parameters {
 	Parameters();
 	bool paramsChanged(const Parameters &other) const;
 	bool orbitChanged(const Parameters &other) const;
 	void resize(QSize newSize);
 	void reset();
+	void save(QSettings &ini) const;
+	void load(QSettings &ini);
 
 	complex point2complex(QPoint p);
 	QPoint  complex2point(complex z);
 	complex distance2complex(QPointF d);
 	int rootContainsPoint(QPoint point);
+	QVector<RootCluster> rootClusters() const;
 	QVector<QVector2D> rootsVec2();
 	QVector<QVector3D> colorsVec3();
 
@@ -38,18 +57,25 @@ struct Parameters {
 	Limits limits;
 	QSize size;
 	quint16 maxIterations;
+	bool autoIterations;
+	bool basinLookup;
+	bool certifyTiles;
 	complex damping;
+	Method method;
 	double scaleDownFactor;
+	quint16 frameTime;
 	bool scaleDown;
 	Processor processor;
 	bool orbitMode;
 	QPoint orbitStart;
 	bool benchmark;
 	uint scaleUpFactor;
+	uint antiAliasing;
 };
 
 // Does not really belong here, but I don't care
 complex string2complex(const QString &text);
+QSize string2size(const QString &text, QSize fallback);
 QString complex2string(complex z, quint8 precision = 2);
 QVector2D complex2vec2(complex z);
 QString dynamicFileName(const Parameters &params, const QString &ext);
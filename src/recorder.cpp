@@ -0,0 +1,296 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "recorder.h"
+#include <QCoreApplication>
+#include <QMouseEvent>
+#include <QWheelEvent>
+#include <QTextStream>
+#include <QSettings>
+#include <QWidget>
+#include <QFile>
+#include <algorithm>
+
+RecordedEvent::RecordedEvent() :
+	time(0),
+	type(QEvent::None),
+	button(Qt::NoButton),
+	buttons(Qt::NoButton),
+	modifiers(Qt::NoModifier),
+	delta(0)
+{
+}
+
+Recorder::Recorder(QObject *parent) :
+	QObject(parent),
+	state_(NotRecording),
+	target_(nullptr),
+	next_(0),
+	receivedAt_(-1),
+	frames_(0),
+	dropped_(0),
+	coalesced_(0),
+	unpresented_(false)
+{
+	// Dispatch recorded events one after another
+	replayTimer_.setSingleShot(true);
+	connect(&replayTimer_, &QTimer::timeout, this, &Recorder::dispatchNext);
+}
+
+RecorderState Recorder::state() const
+{
+	// Return current state
+	return state_;
+}
+
+void Recorder::startRecording(const Parameters &params)
+{
+	// Remember initial parameters to replay from the same state
+	if (state_ != NotRecording) return;
+	initial_ = params;
+	events_.clear();
+	state_ = Recording;
+	clock_.start();
+}
+
+bool Recorder::stopRecording(const QString &file)
+{
+	// Stop and discard if no file given
+	if (state_ != Recording) return false;
+	state_ = NotRecording;
+	if (file.isEmpty()) return false;
+
+	// Write initial parameters and events to ini file
+	QSettings ini(file, QSettings::IniFormat);
+	ini.clear();
+	initial_.save(ini);
+	ini.beginWriteArray("Events", events_.count());
+	for (int i = 0; i < events_.count(); ++i) {
+		const RecordedEvent &e = events_[i];
+		ini.setArrayIndex(i);
+		ini.setValue("event", QString("%1 %2 %3 %4 %5 %6 %7 %8")
+			.arg(e.time).arg(static_cast<int>(e.type)).arg(e.pos.x()).arg(e.pos.y())
+			.arg(e.button).arg(e.buttons).arg(e.modifiers).arg(e.delta));
+	}
+	ini.endArray();
+	ini.sync();
+	return ini.status() == QSettings::NoError;
+}
+
+bool Recorder::load(const QString &file, Parameters &params)
+{
+	// Read initial parameters
+	if (state_ != NotRecording) return false;
+	QSettings ini(file, QSettings::IniFormat);
+	params.load(ini);
+	file_ = file;
+
+	// Read events
+	events_.clear();
+	int count = ini.beginReadArray("Events");
+	for (int i = 0; i < count; ++i) {
+		ini.setArrayIndex(i);
+		QStringList parts = ini.value("event").toString().split(' ');
+		if (parts.length() == 8) {
+			RecordedEvent e;
+			e.time = parts[0].toLongLong();
+			e.type = static_cast<QEvent::Type>(parts[1].toInt());
+			e.pos = QPoint(parts[2].toInt(), parts[3].toInt());
+			e.button = parts[4].toInt();
+			e.buttons = parts[5].toInt();
+			e.modifiers = parts[6].toInt();
+			e.delta = parts[7].toInt();
+			events_.append(e);
+		}
+	}
+	ini.endArray();
+	return !events_.isEmpty() && params.roots.count() > 0;
+}
+
+void Recorder::replay(QWidget *target)
+{
+	// Reset statistics
+	if (state_ != NotRecording || events_.isEmpty()) return;
+	target_ = target;
+	next_ = 0;
+	receivedAt_ = -1;
+	submitted_.clear();
+	inFlight_.clear();
+	rendered_.clear();
+	latencies_.clear();
+	frames_ = 0;
+	dropped_ = 0;
+	coalesced_ = 0;
+	unpresented_ = false;
+	state_ = Replaying;
+
+	// Give the widget time to settle into the initial state
+	QTimer::singleShot(nf::RSD, this, [this]() {
+		clock_.start();
+		dispatchNext();
+	});
+}
+
+void Recorder::inputReceived(QInputEvent *event)
+{
+	// Timestamp replayed input as early as possible
+	if (state_ == Replaying) {
+		receivedAt_ = clock_.nsecsElapsed();
+		return;
+	}
+
+	// Append event to recording
+	if (state_ != Recording) return;
+	RecordedEvent e;
+	e.time = clock_.elapsed();
+	e.type = event->type();
+	e.modifiers = event->modifiers();
+	if (e.type == QEvent::Wheel) {
+		QWheelEvent *we = static_cast<QWheelEvent*>(event);
+		e.pos = we->pos();
+		e.buttons = we->buttons();
+		e.delta = we->angleDelta().y();
+	} else {
+		QMouseEvent *me = static_cast<QMouseEvent*>(event);
+		e.pos = me->pos();
+		e.button = me->button();
+		e.buttons = me->buttons();
+	}
+	events_.append(e);
+}
+
+void Recorder::inputSubmitted()
+{
+	// Input changed the parameters -> wait for its frame
+	// Input that never reaches this point (e.g. hovering) is not timed
+	if (state_ == Replaying && receivedAt_ >= 0) {
+		submitted_.append(receivedAt_);
+		receivedAt_ = -1;
+	}
+}
+
+void Recorder::renderStarted()
+{
+	// Everything submitted so far is part of this frame
+	if (state_ == Replaying) {
+		inFlight_ += submitted_;
+		submitted_.clear();
+	}
+}
+
+void Recorder::frameRendered()
+{
+	// Frame is ready but not on screen yet
+	if (state_ == Replaying) {
+		rendered_ += inFlight_;
+		inFlight_.clear();
+	}
+}
+
+void Recorder::imageRendered()
+{
+	// Complete image replaces one that never reached the screen -> dropped frame
+	if (state_ != Replaying) return;
+	if (unpresented_) ++dropped_;
+	unpresented_ = true;
+}
+
+void Recorder::framePresented()
+{
+	// Measure input-to-photon latency for all inputs shown by this frame
+	unpresented_ = false;
+	if (state_ != Replaying || rendered_.isEmpty()) return;
+	qint64 now = clock_.nsecsElapsed();
+	for (qint64 received : rendered_) {
+		latencies_.append((now - received) / 1e6);
+	}
+
+	// All but the latest input did not get a frame of their own (coalesced, not dropped frames)
+	coalesced_ += rendered_.count() - 1;
+	rendered_.clear();
+	++frames_;
+}
+
+void Recorder::dispatchNext()
+{
+	// Synthesize and send the next event
+	if (state_ != Replaying) return;
+	const RecordedEvent &e = events_[next_];
+	Qt::MouseButtons buttons(e.buttons);
+	Qt::KeyboardModifiers modifiers(e.modifiers);
+	if (e.type == QEvent::Wheel) {
+		QWheelEvent event(QPointF(e.pos), QPointF(target_->mapToGlobal(e.pos)), QPoint(), QPoint(0, e.delta),
+			buttons, modifiers, Qt::NoScrollPhase, false);
+		QCoreApplication::sendEvent(target_, &event);
+	} else {
+		QMouseEvent event(e.type, QPointF(e.pos), static_cast<Qt::MouseButton>(e.button), buttons, modifiers);
+		QCoreApplication::sendEvent(target_, &event);
+	}
+
+	// Schedule next event at its recorded time or let the last frames arrive
+	if (++next_ < events_.count()) {
+		replayTimer_.start(qMax(qint64(0), events_[next_].time - clock_.elapsed()));
+	} else QTimer::singleShot(nf::RSD, this, &Recorder::finishReplay);
+}
+
+void Recorder::finishReplay()
+{
+	// Input that never made it to the screen counts as coalesced too
+	coalesced_ += submitted_.count() + inFlight_.count() + rendered_.count();
+	submitted_.clear();
+	inFlight_.clear();
+	rendered_.clear();
+	state_ = NotRecording;
+
+	// Save report next to the session
+	QString text = report();
+	QFile f(file_ + ".latency.txt");
+	if (f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+		QTextStream(&f) << text;
+	}
+	emit replayFinished(text);
+}
+
+QString Recorder::report() const
+{
+	// Static output strings
+	static const QString out =
+		"Replayed %1 events in %2 ms\n"
+		"Presented frames: %3\n"
+		"Dropped frames (rendered, never presented): %4\n"
+		"Coalesced inputs (no frame of their own): %5\n\n"
+		"Input-to-photon latency [ms]:\n"
+		"min %6, mean %7, max %8\n"
+		"p50 %9, p90 %10, p99 %11\n";
+	static const QString bucket = "\n%1 %2 ms: %3";
+	static const double edges[] = { 8, 16, 33, 66, 100 };
+
+	// Sort latencies for percentiles
+	QVector<double> sorted = latencies_;
+	std::sort(sorted.begin(), sorted.end());
+	int n = sorted.count();
+	double sum = 0;
+	for (double l : sorted) sum += l;
+	auto percentile = [&sorted, n](double p) {
+		return n == 0 ? 0.0 : sorted[qMin(n - 1, static_cast<int>(p * (n - 1) + 0.5))];
+	};
+
+	// Create report
+	QString text = out
+		.arg(events_.count()).arg(events_.isEmpty() ? 0 : events_.last().time)
+		.arg(frames_).arg(dropped_).arg(coalesced_)
+		.arg(n ? sorted.first() : 0.0, 0, 'f', 2).arg(n ? sum / n : 0.0, 0, 'f', 2).arg(n ? sorted.last() : 0.0, 0, 'f', 2)
+		.arg(percentile(0.5), 0, 'f', 2).arg(percentile(0.9), 0, 'f', 2).arg(percentile(0.99), 0, 'f', 2);
+
+	// Append histogram
+	int i = 0;
+	for (double edge : edges) {
+		int count = 0;
+		while (i < n && sorted[i] < edge) { ++count; ++i; }
+		text += bucket.arg("<", -2).arg(edge, 3).arg(count);
+	}
+	text += bucket.arg(">=", -2).arg(edges[4], 3).arg(n - i);
+	return text;
+}
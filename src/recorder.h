@@ -0,0 +1,79 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "parameters.h"
+#include <QObject>
+#include <QTimer>
+#include <QEvent>
+#include <QElapsedTimer>
+
+class QWidget;
+class QInputEvent;
+
+enum RecorderState : quint8 { NotRecording, Recording, Replaying };
+
+struct RecordedEvent {
+	RecordedEvent();
+	qint64 time;
+	QEvent::Type type;
+	QPoint pos;
+	int button;
+	int buttons;
+	int modifiers;
+	int delta;
+};
+
+class Recorder : public QObject
+{
+	Q_OBJECT
+
+public:
+	Recorder(QObject *parent = nullptr);
+	RecorderState state() const;
+	void startRecording(const Parameters &params);
+	bool stopRecording(const QString &file);
+	bool load(const QString &file, Parameters &params);
+	void replay(QWidget *target);
+	void inputReceived(QInputEvent *event);
+	void inputSubmitted();
+
+public slots:
+	void renderStarted();
+	void frameRendered();
+	void imageRendered();
+	void framePresented();
+
+protected:
+	void dispatchNext();
+	void finishReplay();
+	QString report() const;
+
+signals:
+	void replayFinished(const QString &report);
+
+private:
+	RecorderState state_;
+	QElapsedTimer clock_;
+	QTimer replayTimer_;
+	QString file_;
+	Parameters initial_;
+	QVector<RecordedEvent> events_;
+	QWidget *target_;
+	int next_;
+	qint64 receivedAt_;
+	QVector<qint64> submitted_;
+	QVector<qint64> inFlight_;
+	QVector<qint64> rendered_;
+	QVector<double> latencies_;
+	quint32 frames_;
+	quint32 dropped_;
+	quint32 coalesced_;
+	bool unpresented_;
+};
+
+#endif // RECORDER_H
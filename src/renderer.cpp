@@ -4,68 +4,32 @@
 // see the file LICENSE in the main directory.
 
 #include "renderer.h"
+#include "kernel.h"
+#include "floatkernel.h"
 #include <QImage>
 #include <QPixmap>
+#include <QPainter>
+#include <QSettings>
 #include <QFutureWatcher>
-
-inline void func(complex z, complex &f, complex &df, const QVector<Root> &roots)
-{
-	// Calculate f and derivative with given roots
-	quint8 rootCount = roots.length();
-	if (rootCount < 2) return;
-
-	// TODO: algorithm documentation
-	complex r = (z - roots[0].value());
-	complex l = (z - roots[1].value());
-	for (quint8 i = 1; i < rootCount - 1; ++i) {
-		l = (z - roots[i + 1].value()) * (l + r);
-		r *= (z - roots[i].value());
-	}
-	df = l + r;
-	f = r * (z - roots[rootCount - 1].value());
-}
-
-inline void iterateX(ImageLine &il)
-{
-	// Iterate x-pixels
-	const quint8 rootCount = il.params->roots.count();
-	const double left = il.params->limits.left();
-	const double xFactor = il.params->limits.width() / (il.lineSize - 1);
-	const complex d = il.params->damping;
-
-	for (int x = 0; x < il.lineSize; ++x) {
-
-		// Create complex number from current pixel
-		il.zx = x * xFactor + left;
-		complex z(il.zx, il.zy);
-
-		// Newton iteration
-		for (quint16 i = 0; i < il.params->maxIterations; ++i) {
-			complex f, df;
-			func(z, f, df, il.params->roots);
-			complex z0 = z - d * f / df; // <- expensive division
-
-			// If root has been found set color and break
-			if (abs(z0 - z) < nf::EPS) {
-				for (quint8 r = 0; r < rootCount; ++r) {
-					if (abs(z0 - il.params->roots[r].value()) < nf::EPS) {
-						il.scanLine[x] = il.params->roots[r].color().darker(60 + i * 8).rgb();
-						goto POINT_DONE;
-					}
-				}
-			}
-			z = z0;
-		}
-		POINT_DONE:;
-	}
-}
+#include <algorithm>
 
 Renderer::Renderer(QObject *parent) :
-	QObject(parent)
+	QObject(parent),
+	deepValid_(false),
+	presenting_(false),
+	focus_(-1, -1)
 {
+	// Don't wait forever for frames that are never presented (hidden widget)
+	presentTimer_.setInterval(nf::PTO);
+	presentTimer_.setSingleShot(true);
+	partialTimer_.setInterval(nf::IPI);
+
 	// Connect signals
 	connect(&watcher_, &QFutureWatcher<void>::finished, this, &Renderer::onFinished);
 	connect(&watcher_, &QFutureWatcher<void>::progressValueChanged, this, &Renderer::onProgressChanged);
+	connect(&presentTimer_, &QTimer::timeout, this, &Renderer::framePresented);
+	connect(&partialTimer_, &QTimer::timeout, this, &Renderer::presentPartial);
+	connect(&exporter_, &ImageExporter::resumeRequested, this, &Renderer::runNext);
 }
 
 Renderer::~Renderer()
@@ -75,10 +39,11 @@ Renderer::~Renderer()
 
 void Renderer::render(const Parameters &params)
 {
-	// Set next params and run if not running
+	// Latest wins: requests coalesce into nextParams_ until the renderer is ready
+	speculator_.preempt();
+	exporter_.preempt();
 	nextParams_ = params;
-	if (!watcher_.isRunning())
-		run();
+	runNext();
 }
 
 void Renderer::stop()
@@ -88,6 +53,124 @@ void Renderer::stop()
 		watcher_.future().cancel();
 }
 
+QImage Renderer::renderImage(const Parameters &params, bool parallel, KernelStats *stats, const KernelPlan *plan)
+{
+	// Create lines, with the given plan or one of params
+	QImage image(params.size, QImage::Format_RGB32);
+	QVector<ImageLine> lines(image.height());
+	const KernelPlan own = plan ? KernelPlan() : createPlan(params);
+	if (!plan) plan = &own;
+	const double xFactor = params.limits.width() / (image.width() - 1);
+	const double yFactor = -params.limits.height() / (image.height() - 1);
+	for (int y = 0; y < image.height(); ++y) {
+		ImageLine il((QRgb*)(image.scanLine(y)), y, image.width(), &params);
+		il.zy = y * yFactor + params.limits.top();
+		il.hx = xFactor;
+		il.plan = plan;
+		lines[y] = il;
+	}
+
+	// Render synchronously on the whole thread pool or in the calling thread
+	if (parallel) {
+		QtConcurrent::blockingMap(lines, iterateX);
+	} else {
+		for (ImageLine &il : lines) iterateX(il);
+	}
+
+	// Sum up line statistics
+	if (stats) {
+		for (const ImageLine &il : lines) *stats += il.stats;
+	}
+	return image;
+}
+
+KernelStats Renderer::stats() const
+{
+	// Iteration statistics of the last frame
+	return stats_;
+}
+
+Speculator *Renderer::speculator()
+{
+	// Speculative pre-rendering of neighboring views
+	return &speculator_;
+}
+
+FrameGovernor *Renderer::governor()
+{
+	// Preview resolution and iteration cap
+	return &governor_;
+}
+
+IterationTuner *Renderer::tuner()
+{
+	// Automatic iteration cap
+	return &tuner_;
+}
+
+TileCertifier *Renderer::certifier()
+{
+	// Tile certification rate
+	return &certifier_;
+}
+
+ImageExporter *Renderer::exporter()
+{
+	// Offscreen export in idle time
+	return &exporter_;
+}
+
+const Calibration &Renderer::calibration() const
+{
+	// Thread count, tile size and float lanes in use
+	return calibration_;
+}
+
+bool Renderer::loadCalibration()
+{
+	// False if this machine was never calibrated
+	QSettings settings;
+	return calibration_.load(settings);
+}
+
+void Renderer::calibrate()
+{
+	// The pool must be free -> let the current frame finish, pause speculation and exports
+	speculator_.preempt();
+	exporter_.preempt();
+	watcher_.waitForFinished();
+	QThreadPool::globalInstance()->waitForDone();
+	calibration_ = Calibrator::calibrate();
+	QSettings settings;
+	calibration_.save(settings);
+
+	// Resume exports, speculation and requests that came in meanwhile
+	runNext();
+}
+
+bool Renderer::exportImage(const Parameters &params, QSize size, const QString &file)
+{
+	// Exports take the idle time before speculation, false if the image cannot be allocated
+	speculator_.preempt();
+	if (!exporter_.start(params, size, file, calibration_.tileSize)) return false;
+	runNext();
+	return true;
+}
+
+void Renderer::setCursorPos(QPoint pos)
+{
+	// Zoom speculation and tile order follow the cursor
+	focus_ = pos;
+	if (speculator_.setCursor(pos))
+		runNext();
+}
+
+void Renderer::setFocusPos(QPoint pos)
+{
+	// Tiles nearest to pos come first (view center if outside)
+	focus_ = pos;
+}
+
 void Renderer::onProgressChanged(int value)
 {
 	// Emit signal if benchmarking
@@ -97,11 +180,91 @@ void Renderer::onProgressChanged(int value)
 
 void Renderer::onFinished()
 {
+	// Sum up line statistics
+	stats_ = KernelStats();
+	qint64 pixels = 0;
+	partialTimer_.stop();
+	if (!tilesp_.isNull()) {
+		for (const ImageTile &tile : *tilesp_) {
+			for (const ImageLine &il : tile.lines) {
+				stats_ += il.stats;
+				pixels += il.lineSize;
+			}
+		}
+	}
+
 	// Emit signal
 	if (!imagep_.isNull()) {
 		if (curParams_.benchmark) emit benchmarkFinished(imagep_.data());
-		else emit fractalRendered(QPixmap::fromImage(*imagep_.data()), 1000.0 / timer_.elapsed());
+		else {
+			symmetry_.apply(*imagep_, frameParams_, plan_);
+			if (curParams_.scaleDown) governor_.measure(curParams_, pixels, stats_.iterations, timer_.nsecsElapsed() / 1e6);
+			if (curParams_.autoIterations) {
+				tuner_.measure(curParams_, frameParams_.maxIterations, stats_);
+				emit iterationsTuned(tuner_.iterations(curParams_));
+			}
+			if (curParams_.certifyTiles) certifier_.measure(stats_, pixels);
+			speculator_.prepareVariants(frameParams_, curParams_.size * budget_.scale);
+			if (!curParams_.scaleDown) speculator_.prepare(tunedParams_, *imagep_);
+			presentFrame(QPixmap::fromImage(*imagep_.data()), 1000.0 / timer_.elapsed());
+		}
 	}
+
+	// Orbits that ran into the cap, per row in image coordinates (states are only complete if not canceled)
+	if (deepValid_ && watcher_.future().isCanceled()) deepValid_ = false;
+	if (deepValid_ && !tilesp_.isNull()) {
+		for (QVector<ResumePoint> &row : resume_) row.clear();
+		for (ImageTile &tile : *tilesp_) {
+			for (ImageLine &il : tile.lines) {
+				for (ResumePoint &point : il.resume) point.x += tile.rect.left();
+				resume_[il.lineIndex] += il.resume;
+				il.resume.clear();
+			}
+		}
+	}
+
+	// Catch up with requests that came in while rendering
+	runNext();
+}
+
+void Renderer::framePresented()
+{
+	// Frame is on screen (or timed out) -> render the latest request
+	presenting_ = false;
+	presentTimer_.stop();
+	runNext();
+}
+
+void Renderer::presentPartial()
+{
+	// Copy the tiles that are done by now and show the frame so far
+	if (!watcher_.isRunning() || tilesp_.isNull()) return;
+	for (ImageTile &tile : *tilesp_) {
+		if (!tile.done.testAndSetOrdered(1, 2)) continue;
+		for (const ImageLine &il : tile.lines) {
+			std::copy(il.scanLine, il.scanLine + il.lineSize, reinterpret_cast<QRgb*>(partial_.scanLine(il.lineIndex)) + tile.rect.left());
+		}
+	}
+	emit fractalRendered(QPixmap::fromImage(partial_), curParams_.limits, 1000.0 / qMax(qint64(1), timer_.elapsed()), true);
+}
+
+void Renderer::runNext()
+{
+	// Frame pacing: one frame in flight and none waiting to be presented
+	if (watcher_.isRunning() || presenting_) return;
+	run();
+
+	// Still idle -> exported tiles, else speculative ones until the next request preempts them
+	if (!watcher_.isRunning() && !presenting_ && !exporter_.resume())
+		speculator_.resume();
+}
+
+void Renderer::presentFrame(const QPixmap &pixmap, double fps, bool partial)
+{
+	// Hold back the next frame until this one was presented
+	presenting_ = true;
+	presentTimer_.start();
+	emit fractalRendered(pixmap, curParams_.limits, fps, partial);
 }
 
 void Renderer::run()
@@ -113,6 +276,7 @@ void Renderer::run()
 	if (paramsChanged || orbitChanged)
 		curParams_ = nextParams_;
 	else return;
+	emit renderStarted();
 
 	// Rerender pixmap
 	if (paramsChanged)
@@ -127,15 +291,21 @@ void Renderer::renderFractal()
 {
 	// OpenGL not here
 	if (curParams_.processor == GPU_OPENGL) {
-		emit fractalRendered(QPixmap(), 0);
+		presentFrame(QPixmap(), 0);
 		return;
 	}
 
-	// Get new size
+	// Get new size, previews get theirs and an iteration cap from the governor
 	QSize size = curParams_.size;
 	bool bm = curParams_.benchmark;
 	bool sd = curParams_.scaleDown;
-	size *= bm ? curParams_.scaleUpFactor : sd ? curParams_.scaleDownFactor : 1;
+	Parameters previous = frameParams_;
+	tunedParams_ = curParams_;
+	if (!bm) tunedParams_.maxIterations = tuner_.iterations(curParams_);
+	budget_ = sd && !bm ? governor_.budget(tunedParams_) : FrameBudget{curParams_.scaleDownFactor, tunedParams_.maxIterations};
+	size *= bm ? curParams_.scaleUpFactor : sd ? budget_.scale : 1;
+	frameParams_ = tunedParams_;
+	frameParams_.maxIterations = budget_.iterations;
 
 	// TODO: Allocate memory on hard disk and write directly to a file
 	// Otherwise RAM won't be enough
@@ -147,43 +317,183 @@ void Renderer::renderFractal()
 
 	// Create image for fast pixel IO
 	const qint32 height = size.height();
-	const double yFactor = -curParams_.limits.height() / (height - 1);
-	QVector<ImageLine> *lines = new QVector<ImageLine>(height);
+	QScopedPointer<QImage> last(imagep_.take());
 	QImage *image = new QImage(size, QImage::Format_RGB32);
-	linesp_.reset(lines);
 	imagep_.reset(image);
-	image->fill(Qt::black);
+	plan_ = createPlan(frameParams_);
 
-	// Iterate y-pixels
-	for (int y = 0; y < height; ++y) {
-		ImageLine il((QRgb*)(image->scanLine(y)), y, image->width(), &curParams_);
-		il.zy = y * yFactor + curParams_.limits.top();
-		(*lines)[y] = il;
+	// Same settled frame with another iteration cap: recolor known pixels, resume the capped orbits
+	Parameters deep = deepParams_;
+	deep.maxIterations = frameParams_.maxIterations;
+	const bool deepen = !sd && !bm && deepValid_ && !plan_.large && deepSize_ == size && !deep.paramsChanged(frameParams_);
+
+	// Settled frame of the previewed view: the upscaled preview stands in for tiles not done yet
+	previous.scaleDown = sd;
+	previous.maxIterations = curParams_.maxIterations;
+	const bool incremental = !deepen && !sd && !bm && !last.isNull() && !last->isNull() && !previous.paramsChanged(curParams_);
+	if (incremental) {
+		QPainter painter(image);
+		painter.setRenderHint(QPainter::SmoothPixmapTransform);
+		painter.drawImage(image->rect(), *last);
+	} else if (!deepen) image->fill(Qt::black);
+
+	// Interactive previews run in float32 as long as the zoom level allows it
+	if (sd && !bm) selectPrecision(plan_, frameParams_, size);
+
+	// Lines pre-rendered by the speculator are taken as they are
+	QVector<bool> filled(height, false);
+	bool fromVariant = false;
+	if (!bm && !deepen && speculator_.lookup(tunedParams_, *image, filled) < height) {
+
+		// Edited root / damping: a pre-rendered variant (snapped to the lattice) is the preview,
+		// settled frames only show it until the exact render is done
+		const QImage *variant = speculator_.variant(frameParams_, curParams_.size * budget_.scale);
+		if (variant != nullptr && sd) {
+			*image = variant->copy();
+			filled.fill(true);
+			fromVariant = true;
+		} else if (variant != nullptr) {
+			presentFrame(QPixmap::fromImage(*variant), 1000.0 / qMax(qint64(1), timer_.elapsed()), true);
+		}
+	}
+
+	// Rows and columns mapped by a symmetry of the roots are not rendered (variants are complete, maybe in another size)
+	const bool complete = !filled.contains(true);
+	symmetry_ = bm || fromVariant ? Symmetry() : Symmetry(frameParams_, plan_, size);
+	symmetry_.markRows(filled);
+
+	// Remaining y-pixels in tiles around the focus (cursor, dragged root or view center)
+	const QRect view(QPoint(0, 0), curParams_.size);
+	const QPointF focus = QPointF(view.contains(focus_) ? focus_ : view.center()) * (double(size.width()) / curParams_.size.width());
+	plan_.lanes = calibration_.lanes;
+	tilesp_.reset(new QVector<ImageTile>());
+	if (filled.contains(false)) createTiles(*tilesp_, *image, filled, frameParams_, &plan_, calibration_.tileSize, focus, &symmetry_);
+
+	// Fully rendered settled frames keep the outcome of every pixel for later deepening
+	const int width = size.width();
+	deepValid_ = deepen || (!sd && !bm && !plan_.large && complete);
+	deepParams_ = frameParams_;
+	deepSize_ = size;
+
+	// Basin lookups read the outcome of finished tiles (double precision only)
+	const bool lookups = curParams_.basinLookup && !bm && !deepen && !plan_.large && plan_.precision == DoublePrecision;
+	if (deepValid_ || lookups) {
+		states_.resize(width * height);
+		if (lookups) basins_.create(*tilesp_, frameParams_, size, symmetry_.isEmpty() ? 0 : symmetry_.left(), symmetry_.isEmpty() ? width - 1 : symmetry_.right(), calibration_.tileSize);
+		if (deepValid_ && !deepen) resume_ = QVector<QVector<ResumePoint>>(height);
+		for (ImageTile &tile : *tilesp_) {
+			const int left = tile.rect.left(), right = tile.rect.right();
+			tile.deepen = deepen;
+			tile.basins = lookups ? &basins_ : nullptr;
+			for (ImageLine &il : tile.lines) {
+				il.states = states_.data() + il.lineIndex * width + left;
+				if (lookups) il.basins = &basins_;
+				if (!deepen) continue;
+				for (ResumePoint point : resume_[il.lineIndex]) {
+					if (point.x < left || point.x > right) continue;
+					point.x -= left;
+					il.resume.append(point);
+				}
+			}
+		}
+	}
+
+	// Blocks proven to converge uniformly are filled without iterating their pixels
+	const bool certify = !bm && !deepen && TileCertifier::applicable(frameParams_, plan_);
+	for (ImageTile &tile : *tilesp_) tile.certify = certify;
+	if (incremental) {
+		partial_ = image->copy();
+		partialTimer_.start();
 	}
 
 	// Set thread count to either single or multicore
-	uint threadCount = curParams_.processor == CPU_SINGLE ? 1 : QThread::idealThreadCount();
+	uint threadCount = curParams_.processor == CPU_SINGLE ? 1 : calibration_.threads;
 	QThreadPool::globalInstance()->setMaxThreadCount(threadCount);
 
-	// Iterate x-pixels with watcher
-	watcher_.setFuture(QtConcurrent::map(*lines, iterateX));
+	// Iterate tiles with watcher
+	watcher_.setFuture(QtConcurrent::map(*tilesp_, renderTile));
+}
+
+void Renderer::createTiles(QVector<ImageTile> &tiles, QImage &image, const QVector<bool> &filled, const Parameters &params, const KernelPlan *plan, int tileSize, QPointF focus, const Symmetry *symmetry)
+{
+	// Grid of tiles (the last ones take the rest) with lines the speculator did not fill, within the rendered columns
+	const int width = image.width(), height = image.height();
+	const bool mapped = symmetry && !symmetry->isEmpty();
+	const int left = mapped ? symmetry->left() : 0, right = mapped ? symmetry->right() : width - 1;
+	const int columns = qMax(1, (right - left + 1) / tileSize), rows = qMax(1, height / tileSize);
+	const double fx = focus.x(), fy = focus.y();
+	tiles.clear();
+	tiles.reserve(columns * rows);
+	for (int row = 0; row < rows; ++row) {
+		for (int column = 0; column < columns; ++column) {
+			const int x = left + column * tileSize, y = row * tileSize;
+			const int h = row == rows - 1 ? height - y : tileSize;
+			if (std::count(filled.constBegin() + y, filled.constBegin() + y + h, false) == 0) continue;
+			ImageTile tile;
+			tile.rect = QRect(x, y, column == columns - 1 ? right + 1 - x : tileSize, h);
+			const double dx = 0.5 * (tile.rect.left() + tile.rect.right()) - fx;
+			const double dy = 0.5 * (tile.rect.top() + tile.rect.bottom()) - fy;
+			tile.distance = dx * dx + dy * dy;
+			tiles.append(tile);
+		}
+	}
+
+	// Nearest to the focus first (cursor, dragged root or view center)
+	std::sort(tiles.begin(), tiles.end(), [](const ImageTile &a, const ImageTile &b) {
+		return a.distance < b.distance;
+	});
+
+	// Lines point to the parameters of their tile -> only after sorting
+	const Limits &l = params.limits;
+	const double hx = l.width() / (width - 1);
+	const double hy = l.height() / (height - 1);
+	for (ImageTile &tile : tiles) {
+		const QRect &rect = tile.rect;
+		tile.params = params;
+		tile.params.limits.set(l.left() + rect.left() * hx, l.left() + rect.right() * hx, l.top() - rect.top() * hy, l.top() - rect.bottom() * hy);
+		tile.params.size = rect.size();
+		for (int y = rect.top(); y <= rect.bottom(); ++y) {
+			if (filled[y]) continue;
+			ImageLine il(reinterpret_cast<QRgb*>(image.scanLine(y)) + rect.left(), y, rect.width(), &tile.params);
+			il.zy = l.top() - y * hy;
+			il.hx = hx;
+			il.plan = plan;
+			tile.lines.append(il);
+		}
+	}
+}
+
+void Renderer::renderTile(ImageTile &tile)
+{
+	// Lines of one tile in the precision chosen for the frame (or resumed with a new cap, or certified blocks first)
+	if (tile.certify) {
+		TileCertifier::render(tile);
+	} else {
+		for (ImageLine &il : tile.lines) {
+			if (tile.deepen) deepenX(il);
+			else if (il.plan->precision == FloatPrecision) iterateXFloat(il);
+			else iterateX(il);
+		}
+	}
+	if (tile.basins) tile.basins->classify(tile);
+	tile.done.storeRelease(1);
 }
 
 void Renderer::renderOrbit()
 {
 	// Create vector of points
 	QVector<QPoint> orbit;
-	const complex d = curParams_.damping;
 
 	// Create complex number from current pixel
-	complex z = curParams_.point2complex(curParams_.orbitStart);
+	fcomplex z = curParams_.point2complex(curParams_.orbitStart);
 	orbit.append(curParams_.complex2point(z));
 
-	// Newton iteration
+	// Newton iteration (multiplicity-corrected near root clusters)
+	const QVector<fcomplex> roots = rootValues(curParams_);
+	const QVector<RootCluster> clusters = curParams_.method == NEWTON ? curParams_.rootClusters() : QVector<RootCluster>();
+	bool inside = clusters.isEmpty();
 	for (quint16 i = 0; i < curParams_.maxIterations; ++i) {
-		complex f, df;
-		func(z, f, df, curParams_.roots);
-		complex z0 = z - d * f / df;
+		fcomplex z0 = z - (inside ? 1 : multiplicity(z, clusters, inside)) * methodStep(z, &curParams_, roots);
 
 		// Append point to vector
 		orbit.append(curParams_.complex2point(z0));
@@ -8,9 +8,18 @@
 
 #include "parameters.h"
 #include "imageline.h"
+#include "kernel.h"
+#include "speculator.h"
+#include "governor.h"
+#include "tuner.h"
+#include "calibrator.h"
+#include "symmetry.h"
+#include "certifier.h"
+#include "exporter.h"
 #include <QObject>
 #include <QtConcurrent>
 #include <QElapsedTimer>
+#include <QTimer>
 
 class Renderer : public QObject
 {
@@ -21,29 +30,73 @@ public:
 	~Renderer();
 	void render(const Parameters &params);
 	void stop();
+	static QImage renderImage(const Parameters &params, bool parallel = false, KernelStats *stats = nullptr, const KernelPlan *plan = nullptr);
+	static void createTiles(QVector<ImageTile> &tiles, QImage &image, const QVector<bool> &filled, const Parameters &params, const KernelPlan *plan, int tileSize, QPointF focus, const Symmetry *symmetry = nullptr);
+	static void renderTile(ImageTile &tile);
+	KernelStats stats() const;
+	Speculator *speculator();
+	FrameGovernor *governor();
+	IterationTuner *tuner();
+	TileCertifier *certifier();
+	ImageExporter *exporter();
+	const Calibration &calibration() const;
+	bool loadCalibration();
+	void calibrate();
+	bool exportImage(const Parameters &params, QSize size, const QString &file);
+	void setCursorPos(QPoint pos);
+	void setFocusPos(QPoint pos);
 
 public slots:
 	void onProgressChanged(int value);
 	void onFinished();
+	void framePresented();
+	void presentPartial();
 
 protected:
+	void runNext();
 	void run();
+	void presentFrame(const QPixmap &pixmap, double fps, bool partial = false);
 	void renderFractal();
 	void renderOrbit();
 
 signals:
-	void fractalRendered(const QPixmap &pixmap, double fps);
+	void renderStarted();
+	void fractalRendered(const QPixmap &pixmap, const Limits &limits, double fps, bool partial);
 	void orbitRendered(const QVector<QPoint> &orbit, double fps);
 	void benchmarkProgress(int min, int max, int progress);
 	void benchmarkFinished(const QImage *image);
+	void iterationsTuned(quint16 iterations);
 
 private:
 	QElapsedTimer timer_;
 	Parameters curParams_;
 	Parameters nextParams_;
+	Parameters tunedParams_;
+	Parameters frameParams_;
+	Parameters deepParams_;
+	QSize deepSize_;
+	bool deepValid_;
 	QScopedPointer<QImage> imagep_;
-	QScopedPointer<QVector<ImageLine>> linesp_;
+	QScopedPointer<QVector<ImageTile>> tilesp_;
+	QImage partial_;
 	QFutureWatcher<void> watcher_;
+	QTimer presentTimer_;
+	QTimer partialTimer_;
+	bool presenting_;
+	QPoint focus_;
+	Speculator speculator_;
+	FrameGovernor governor_;
+	IterationTuner tuner_;
+	TileCertifier certifier_;
+	ImageExporter exporter_;
+	Calibration calibration_;
+	FrameBudget budget_;
+	KernelPlan plan_;
+	Symmetry symmetry_;
+	BasinMap basins_;
+	KernelStats stats_;
+	QVector<PixelState> states_;
+	QVector<QVector<ResumePoint>> resume_;
 };
 
 #endif // RENDERER_H
@@ -5,9 +5,11 @@
 
 #include "rootedit.h"
 #include "parameters.h"
+#include <QWheelEvent>
 
 RootEdit::RootEdit(QWidget *parent) :
-	QLineEdit(parent)
+	QLineEdit(parent),
+	step_(0)
 {
 	// Set geometry and connect signal
 	setValue(complex(0, 0));
@@ -32,3 +34,23 @@ void RootEdit::setValue(complex value)
 	root_ = value;
 	setText(complex2string(value));
 }
+
+void RootEdit::setStep(double step)
+{
+	// Scrub with the mouse wheel if step > 0
+	step_ = step;
+}
+
+void RootEdit::wheelEvent(QWheelEvent *event)
+{
+	// Step real part (imaginary part with shift)
+	QPoint delta = event->angleDelta();
+	if (step_ <= 0 || delta.isNull()) {
+		QLineEdit::wheelEvent(event);
+		return;
+	}
+	double step = delta.y() + delta.x() > 0 ? step_ : -step_;
+	setValue(root_ + (event->modifiers() & Qt::ShiftModifier ? complex(0, step) : complex(step, 0)));
+	event->accept();
+	emit valueChanged();
+}
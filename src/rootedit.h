@@ -17,12 +17,17 @@ public:
 	RootEdit(QWidget *parent = nullptr);
 	complex value() const;
 	void setValue(complex value);
+	void setStep(double step);
+
+protected:
+	void wheelEvent(QWheelEvent *event) override;
 
 signals:
 	void valueChanged();
 
 private:
 	complex root_;
+	double step_;
 };
 
 #endif // ROOTEDIT_H
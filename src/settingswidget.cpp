@@ -12,6 +12,7 @@
 #include <QStandardPaths>
 #include <QColorDialog>
 #include <QFileDialog>
+#include <QCheckBox>
 #include <QSettings>
 #include <QDateTime>
 #include <QMenu>
@@ -53,11 +54,17 @@ SettingsWidget::SettingsWidget(Parameters *params, QWidget *parent) :
 	connect(ui_->lineSize, &SizeEdit::sizeChanged, this, &SettingsWidget::sizeChanged);
 	connect(ui_->btnReset, &QPushButton::clicked, this, &SettingsWidget::reset);
 	connect(ui_->spinScaleDownFactor, QOverload<int>::of(&QSpinBox::valueChanged), this, &SettingsWidget::on_settingsChanged);
+	connect(ui_->spinFrameTime, QOverload<int>::of(&QSpinBox::valueChanged), this, &SettingsWidget::on_settingsChanged);
 	connect(ui_->spinIterations, QOverload<int>::of(&QSpinBox::valueChanged), this, &SettingsWidget::on_settingsChanged);
+	connect(ui_->checkAutoIterations, &QCheckBox::toggled, this, &SettingsWidget::on_settingsChanged);
+	connect(ui_->checkBasinLookup, &QCheckBox::toggled, this, &SettingsWidget::on_settingsChanged);
+	connect(ui_->checkCertifyTiles, &QCheckBox::toggled, this, &SettingsWidget::on_settingsChanged);
 	connect(ui_->spinDegree, QOverload<int>::of(&QSpinBox::valueChanged), this, &SettingsWidget::on_settingsChanged);
 	connect(ui_->lineDamping, &RootEdit::valueChanged, this, &SettingsWidget::on_settingsChanged);
+	ui_->lineDamping->setStep(nf::DST);
 	connect(ui_->spinZoom, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &SettingsWidget::on_settingsChanged);
 	connect(ui_->cbThreading, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &SettingsWidget::on_settingsChanged);
+	connect(ui_->cbMethod, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &SettingsWidget::on_settingsChanged);
 	connect(ui_->cbStyles, QOverload<const QString &>::of(&QComboBox::currentIndexChanged), [this](const QString &style) {
 		QSettings().setValue("style", style);
 		styler_.setStyle(style);
@@ -65,6 +72,11 @@ SettingsWidget::SettingsWidget(Parameters *params, QWidget *parent) :
 	connect(ui_->spinScaleUpFactor, QOverload<int>::of(&QSpinBox::valueChanged), [this](int value) {
 		params_->scaleUpFactor = value;
 	});
+	connect(ui_->spinAntiAliasing, QOverload<int>::of(&QSpinBox::valueChanged), [this](int value) {
+		params_->antiAliasing = value;
+	});
+	ui_->spinAntiAliasing->setMaximum(nf::AAM);
+	connect(ui_->btnCalibrate, &QPushButton::clicked, this, &SettingsWidget::calibrateRequested);
 	connect(ui_->btnBenchmark, &QPushButton::clicked, [this]() {
 		if (ui_->btnBenchmark->property("started").toBool())
 			emit stopBenchmarkRequested();
@@ -95,11 +107,16 @@ void SettingsWidget::updateSettings()
 	quint8 rootCount = params_->roots.count();
 	ui_->lineSize->setValue(params_->size);
 	ui_->spinScaleDownFactor->setValue(params_->scaleDownFactor * 100);
+	ui_->spinFrameTime->setValue(params_->frameTime);
 	ui_->spinZoom->setValue(params_->limits.zoomFactor() * 100);
 	ui_->spinIterations->setValue(params_->maxIterations);
+	ui_->checkAutoIterations->setChecked(params_->autoIterations);
+	ui_->checkBasinLookup->setChecked(params_->basinLookup);
+	ui_->checkCertifyTiles->setChecked(params_->certifyTiles);
 	ui_->spinDegree->setValue(rootCount);
 	ui_->lineDamping->setValue(params_->damping);
 	ui_->cbThreading->setCurrentIndex(static_cast<quint8>(params_->processor));
+	ui_->cbMethod->setCurrentIndex(static_cast<quint8>(params_->method));
 	for (quint8 i = 0; i < rootCount; ++i) {
 		moveRoot(i, params_->roots[i].value());
 	}
@@ -201,6 +218,19 @@ void SettingsWidget::setBenchmarkProgress(int min, int max, int progress)
 	ui_->progressBenchmark->setMaximum(max);
 }
 
+void SettingsWidget::setTunedIterations(quint16 iterations)
+{
+	// Show the cap picked by the auto mode
+	if (params_->autoIterations)
+		ui_->checkAutoIterations->setText(tr("auto (%1)").arg(iterations));
+}
+
+void SettingsWidget::setCalibration(const QString &text)
+{
+	// Configuration picked by the calibration
+	ui_->btnCalibrate->setText(text);
+}
+
 void SettingsWidget::toggleBenchmarking(bool value)
 {
 	// Static icons
@@ -246,42 +276,7 @@ void SettingsWidget::exportSettings()
 
 	// Create ini file
 	QSettings ini(dir + "/" + dynamicFileName(*params_, "ini"), QSettings::IniFormat, this);
-
-	// General parameters
-	ini.beginGroup("Parameters");
-	ini.setValue("size", params_->size);
-	ini.setValue("maxIterations", params_->maxIterations);
-	ini.setValue("damping", complex2string(params_->damping));
-	ini.setValue("scaleDownFactor", params_->scaleDownFactor);
-	ini.setValue("scaleDown", params_->scaleDown);
-	ini.setValue("processor", static_cast<uint>(params_->processor));
-	ini.setValue("orbitMode", params_->orbitMode);
-	ini.setValue("orbitStart", params_->orbitStart);
-	ini.endGroup();
-
-	// Limits
-	ini.beginGroup("Limits");
-	ini.setValue("left", params_->limits.left());
-	ini.setValue("right", params_->limits.right());
-	ini.setValue("top", params_->limits.top());
-	ini.setValue("bottom", params_->limits.bottom());
-	ini.setValue("left_original", params_->limits.original()->left());
-	ini.setValue("right_original", params_->limits.original()->right());
-	ini.setValue("top_original", params_->limits.original()->top());
-	ini.setValue("bottom_original", params_->limits.original()->bottom());
-	ini.endGroup();
-
-	// Roots
-	ini.beginGroup("Roots");
-	quint8 rootCount = params_->roots.count();
-	for (quint8 i = 0; i < rootCount; ++i) {
-		ini.setValue(
-			"root" + QString::number(i),
-			complex2string(params_->roots[i].value(), 10) + " : " + params_->roots[i].color().name()
-		);
-	}
-	ini.endGroup();
-
+	params_->save(ini);
 }
 
 void SettingsWidget::importSettings()
@@ -297,28 +292,28 @@ void SettingsWidget::importSettings()
 
 	// Open ini file
 	QSettings ini(file, QSettings::IniFormat, this);
+	Parameters imported;
+	imported.load(ini);
+	applyParams(imported);
+}
 
-	// General parameters
-	ini.beginGroup("Parameters");
-	params_->size = ini.value("size", QSize(nf::DSI, nf::DSI)).toSize();
-	params_->maxIterations = ini.value("maxIterations", nf::DMI).toUInt();
-	params_->damping = string2complex(ini.value("damping", complex2string(nf::DDP)).toString());
-	params_->scaleDownFactor = ini.value("scaleDownFactor", nf::DSC).toDouble();
-	params_->scaleDown = ini.value("scaleDown", false).toBool();
-	params_->processor = static_cast<Processor>(ini.value("processor", 1).toUInt());
-	params_->orbitMode = ini.value("orbitMode", false).toBool();
-	params_->orbitStart = ini.value("orbitStart").toPoint();
-	ini.endGroup();
-
-	// Limits
-	ini.beginGroup("Limits");
-	params_->limits.set(
-		ini.value("left", 1).toDouble(), ini.value("right", 1).toDouble(),
-		ini.value("top", 1).toDouble(), ini.value("bottom", 1).toDouble());
-	params_->limits.setOriginal(
-		ini.value("left_original", 1).toDouble(), ini.value("right_original", 1).toDouble(),
-		ini.value("top_original", 1).toDouble(), ini.value("bottom_original", 1).toDouble());
-	ini.endGroup();
+void SettingsWidget::applyParams(const Parameters &params)
+{
+	// General parameters and limits
+	params_->size = params.size;
+	params_->maxIterations = params.maxIterations;
+	params_->autoIterations = params.autoIterations;
+	params_->basinLookup = params.basinLookup;
+	params_->certifyTiles = params.certifyTiles;
+	params_->damping = params.damping;
+	params_->method = params.method;
+	params_->scaleDownFactor = params.scaleDownFactor;
+	params_->frameTime = params.frameTime;
+	params_->scaleDown = params.scaleDown;
+	params_->processor = params.processor;
+	params_->orbitMode = params.orbitMode;
+	params_->orbitStart = params.orbitStart;
+	params_->limits = params.limits;
 
 	// Update settings
 	emit sizeChanged(params_->size);
@@ -330,16 +325,10 @@ void SettingsWidget::importSettings()
 		removeRoot();
 	}
 
-	// Add Roots
-	ini.beginGroup("Roots");
-	for (QString key : ini.childKeys()) {
-		QStringList str = ini.value(key).toString().split(":");
-		if (str.length() >= 2) {
-			addRoot(string2complex(str.first()), QColor(str.last().simplified()));
-		}
+	// Add roots
+	for (const Root &root : params.roots) {
+		addRoot(root.value(), root.color());
 	}
-	ini.endGroup();
-
 }
 
 void SettingsWidget::openRootContextMenu()
@@ -394,10 +383,17 @@ void SettingsWidget::on_settingsChanged()
 		// Update fractal with new settings
 		params_->limits.setZoomFactor(ui_->spinZoom->value() / 100.0);
 		params_->maxIterations = ui_->spinIterations->value();
+		params_->autoIterations = ui_->checkAutoIterations->isChecked();
+		if (!params_->autoIterations) ui_->checkAutoIterations->setText(tr("auto"));
+		params_->basinLookup = ui_->checkBasinLookup->isChecked();
+		params_->certifyTiles = ui_->checkCertifyTiles->isChecked();
 		params_->damping = ui_->lineDamping->value();
+		params_->method = static_cast<Method>(ui_->cbMethod->currentIndex());
 		params_->scaleDownFactor = ui_->spinScaleDownFactor->value() / 100.0;
+		params_->frameTime = ui_->spinFrameTime->value();
 		params_->processor = static_cast<Processor>(ui_->cbThreading->currentIndex());
 		params_->scaleUpFactor = ui_->spinScaleUpFactor->value();
+		params_->antiAliasing = ui_->spinAntiAliasing->value();
 
 		// Update rootEdit value
 		if (rootEdits_.size() == params_->roots.count()) {
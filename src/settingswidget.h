@@ -38,10 +38,13 @@ public slots:
 	void removeRoot(qint8 index = -1);
 	void moveRoot(quint8 index, complex value);
 	void setBenchmarkProgress(int min, int max, int progress);
+	void setTunedIterations(quint16 iterations);
+	void setCalibration(const QString &text);
 	void toggleBenchmarking(bool value);
 	void exportImage();
 	void exportSettings();
 	void importSettings();
+	void applyParams(const Parameters &params);
 
 private slots:
 	void openRootContextMenu();
@@ -60,6 +63,7 @@ signals:
 	void exportImageRequested(const QString &dir);
 	void startBenchmarkRequested();
 	void stopBenchmarkRequested();
+	void calibrateRequested();
 	void reset();
 
 private:
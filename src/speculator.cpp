@@ -0,0 +1,470 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "speculator.h"
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+SpeculativeCanvas::SpeculativeCanvas() :
+	kind(CanvasPan),
+	pixels(nullptr),
+	columns(0),
+	rows(0),
+	priority(0)
+{
+}
+
+SpeculativeTile::SpeculativeTile() :
+	canvas(nullptr),
+	done(nullptr),
+	column(0),
+	row(0),
+	distance(0)
+{
+}
+
+Speculator::Speculator() :
+	frames_(0),
+	frameHits_(0),
+	lines_(0),
+	lineHits_(0),
+	edits_(0),
+	editHits_(0)
+{
+}
+
+Speculator::~Speculator()
+{
+	// Tiles write into the canvases
+	preempt();
+}
+
+void Speculator::prepare(const Parameters &params, const QImage &image)
+{
+	// New settled view -> new canvases, old ones only serve as source for prefill
+	preempt();
+	QVector<QSharedPointer<SpeculativeCanvas>> old = canvases_;
+	canvases_.clear();
+	view_ = params;
+	if (params.roots.count() < 2 || image.size() != params.size) return;
+
+	// Pan canvas: the view plus a margin at the same pixel spacing
+	const QSize size = params.size;
+	const Limits &l = params.limits;
+	const int mx = ceil(nf::SPM * size.width());
+	const int my = ceil(nf::SPM * size.height());
+	const double hx = l.width() / (size.width() - 1);
+	const double hy = l.height() / (size.height() - 1);
+	Parameters pan = params;
+	pan.limits.set(l.left() - mx * hx, l.right() + mx * hx, l.top() + my * hy, l.bottom() - my * hy);
+	pan.size = QSize(size.width() + 2 * mx, size.height() + 2 * my);
+	QSharedPointer<SpeculativeCanvas> canvas = createCanvas(CanvasPan, pan);
+
+	// The presented frame is the center, tiles completely inside are done
+	const int cw = pan.size.width();
+	for (int y = 0; y < size.height(); ++y) {
+		const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+		std::copy(line, line + size.width(), canvas->pixels + qint64(y + my) * cw + mx);
+	}
+	for (int row = 0; row < canvas->rows; ++row) {
+		for (int column = 0; column < canvas->columns; ++column) {
+			QRect rect = tileRect(*canvas, column, row);
+			if (rect.left() >= mx && rect.right() < mx + size.width() && rect.top() >= my && rect.bottom() < my + size.height())
+				canvas->done[row * canvas->columns + column] = 1;
+		}
+	}
+	canvases_.append(canvas);
+	createZoomCanvases();
+
+	// Take over what the previous canvases have already rendered
+	for (const QSharedPointer<SpeculativeCanvas> &c : canvases_) prefill(*c, old);
+}
+
+void Speculator::prepareVariants(const Parameters &params, QSize size)
+{
+	// Only edits of exactly one root or the damping since the last frame
+	Parameters previous = previous_;
+	previous_ = params;
+	int root = -1;
+	if (!singleEdit(previous, params, root)) return;
+
+	// View canvases of the old values are useless now, variants of the old edit too
+	preempt();
+	if (!canvases_.isEmpty() && !sameContent(canvases_.first()->params, params)) canvases_.clear();
+	for (const QSharedPointer<SpeculativeCanvas> &variant : variants_) {
+		variant->priority = std::numeric_limits<double>::max();
+	}
+
+	// Root: lattice of preview pixels around it, nearest to the extrapolated position first
+	if (root >= 0) {
+		const double step = params.limits.width() / (size.width() - 1);
+		const complex value = params.roots[root].value();
+		const complex next = 2.0 * value - previous.roots[root].value();
+		const double cx = round(value.real() / step), cy = round(value.imag() / step);
+		for (int dy = -nf::PVR; dy <= nf::PVR; ++dy) {
+			for (int dx = -nf::PVR; dx <= nf::PVR; ++dx) {
+				Parameters variant = params;
+				variant.roots[root].setValue(complex((cx + dx) * step, (cy + dy) * step));
+				addVariant(variant, size, abs(variant.roots[root].value() - next) / step);
+			}
+		}
+
+	// Damping: further steps of the same size, forward first
+	} else {
+		const complex delta = params.damping - previous.damping;
+		for (int k = -nf::PVR; k <= nf::PVR; ++k) {
+			if (k == 0) continue;
+			Parameters variant = params;
+			variant.damping = params.damping + double(k) * delta;
+			addVariant(variant, size, qAbs(k - 1));
+		}
+	}
+
+	// Cap memory, least recently used are at the end
+	qint64 bytes = 0;
+	for (int i = 0; i < variants_.count(); ++i) {
+		bytes += variants_[i]->image.sizeInBytes();
+		if (bytes > nf::PVM) {
+			variants_.resize(i);
+			break;
+		}
+	}
+}
+
+bool Speculator::setCursor(QPoint cursor)
+{
+	// Zoom canvases follow the cursor, the pan canvas stays
+	if (cursor == cursor_) return false;
+	cursor_ = cursor;
+	if (canvases_.isEmpty()) return false;
+	preempt();
+	canvases_.resize(1);
+	createZoomCanvases();
+	return true;
+}
+
+void Speculator::resume()
+{
+	// Continue with the tiles that are not done yet
+	if (future_.isRunning() || (canvases_.isEmpty() && variants_.isEmpty())) return;
+	tiles_.clear();
+	const QSize size = view_.size;
+	for (const QSharedPointer<SpeculativeCanvas> &canvas : canvases_) {
+		const int mx = (canvas->params.size.width() - size.width()) / 2;
+		const int my = (canvas->params.size.height() - size.height()) / 2;
+		for (int row = 0; row < canvas->rows; ++row) {
+			for (int column = 0; column < canvas->columns; ++column) {
+				const int index = row * canvas->columns + column;
+				if (canvas->done[index]) continue;
+
+				// Distance in view pixels: from the view border (pan) or from the cursor (zoom)
+				QPoint center = tileRect(*canvas, column, row).center();
+				double dx, dy;
+				if (canvas->kind == CanvasPan) {
+					dx = qMax(0, qMax(mx - center.x(), center.x() - mx - size.width()));
+					dy = qMax(0, qMax(my - center.y(), center.y() - my - size.height()));
+				} else {
+					dx = center.x() - cursor_.x();
+					dy = center.y() - cursor_.y();
+				}
+				SpeculativeTile tile;
+				tile.canvas = canvas.data();
+				tile.done = canvas->done.data() + index;
+				tile.column = column;
+				tile.row = row;
+				tile.distance = sqrt(dx * dx + dy * dy);
+				tiles_.append(tile);
+			}
+		}
+	}
+
+	// Parameter variants of the current edit, whole variants one after another
+	for (const QSharedPointer<SpeculativeCanvas> &canvas : variants_) {
+		if (canvas->priority == std::numeric_limits<double>::max()) continue;
+		for (int index = 0; index < canvas->done.count(); ++index) {
+			if (canvas->done[index]) continue;
+			SpeculativeTile tile;
+			tile.canvas = canvas.data();
+			tile.done = canvas->done.data() + index;
+			tile.column = index % canvas->columns;
+			tile.row = index / canvas->columns;
+			tile.distance = canvas->priority;
+			tiles_.append(tile);
+		}
+	}
+
+	// Variants before view canvases, nearest first
+	std::stable_sort(tiles_.begin(), tiles_.end(), [](const SpeculativeTile &a, const SpeculativeTile &b) {
+		bool av = a.canvas->kind == CanvasVariant, bv = b.canvas->kind == CanvasVariant;
+		return av != bv ? av : a.distance < b.distance;
+	});
+	if (!tiles_.isEmpty())
+		future_ = QtConcurrent::map(tiles_, renderTile);
+}
+
+void Speculator::preempt()
+{
+	// Drop queued tiles and wait for the running ones (one tile per thread at most)
+	if (!future_.isRunning()) return;
+	future_.cancel();
+	future_.waitForFinished();
+}
+
+int Speculator::lookup(const Parameters &params, QImage &image, QVector<bool> &filled)
+{
+	// Take every line the canvases cover, previews may be sampled from finer canvases
+	preempt();
+	const int width = image.width(), height = image.height();
+	const Limits &l = params.limits;
+	const double hx = l.width() / (width - 1);
+	const double hy = l.height() / (height - 1);
+	int hits = 0;
+	filled.fill(false, height);
+	for (const QSharedPointer<SpeculativeCanvas> &canvas : canvases_) {
+		if (!sameContent(canvas->params, params)) continue;
+		for (int y = 0; y < height; ++y) {
+			if (filled[y]) continue;
+			QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+			if (sample(*canvas, l.left(), l.top() - y * hy, hx, hy, width, !params.scaleDown, line)) {
+				filled[y] = true;
+				++hits;
+			}
+		}
+	}
+
+	// Count hits
+	++frames_;
+	lines_ += height;
+	lineHits_ += hits;
+	if (hits == height) ++frameHits_;
+	return hits;
+}
+
+const QImage *Speculator::variant(const Parameters &params, QSize size)
+{
+	// Completed variant of any size within half a lattice step (good enough for a preview)
+	if (variants_.isEmpty()) return nullptr;
+	preempt();
+
+	// Only frames of a root / damping edit count for the hit rate (not the final frame of an edit)
+	int root = -1;
+	const bool edit = singleEdit(previous_, params, root);
+	if (edit) ++edits_;
+	const double step = params.limits.width() / (size.width() - 1);
+	SpeculativeCanvas *canvas = findVariant(params, QSize(), 0.5 * sqrt(2.0) * step);
+	if (canvas == nullptr || canvas->done.contains(0)) return nullptr;
+	if (edit) ++editHits_;
+	return &canvas->image;
+}
+
+void Speculator::resetStats()
+{
+	// Reset hit counters
+	frames_ = frameHits_ = lines_ = lineHits_ = edits_ = editHits_ = 0;
+}
+
+QString Speculator::report() const
+{
+	// Static output string
+	static const QString out = "Speculative pre-rendering: %1 of %2 frames were complete cache hits (%3 %), %4 % of all lines came from the cache\n"
+		"%5 of %6 root / damping edits were previewed from pre-rendered variants (%7 %)";
+
+	// Hit rates
+	return out.arg(frameHits_).arg(frames_)
+		.arg(100.0 * frameHits_ / qMax(qint64(1), frames_), 0, 'f', 1)
+		.arg(100.0 * lineHits_ / qMax(qint64(1), lines_), 0, 'f', 1)
+		.arg(editHits_).arg(edits_)
+		.arg(100.0 * editHits_ / qMax(qint64(1), edits_), 0, 'f', 1);
+}
+
+bool Speculator::singleEdit(const Parameters &previous, const Parameters &params, int &root)
+{
+	// Exactly one root (root is set) or the damping changed, nothing else but the view and the iteration cap
+	root = -1;
+	if (params.roots.count() < 2 || previous.roots.count() != params.roots.count()) return false;
+	Parameters other = previous;
+	other.limits = params.limits;
+	other.maxIterations = params.maxIterations;
+	other.size = params.size;
+	other.scaleDown = params.scaleDown;
+	other.damping = params.damping;
+	for (int i = 0; i < params.roots.count(); ++i) {
+		if (other.roots[i] == params.roots[i]) continue;
+		if (root >= 0) return false;
+		root = i;
+		other.roots[i] = params.roots[i];
+	}
+	bool damping = previous.damping != params.damping;
+	return (root >= 0) != damping && !params.paramsChanged(other);
+}
+
+QSharedPointer<SpeculativeCanvas> Speculator::createCanvas(CanvasKind kind, const Parameters &params) const
+{
+	// Canvas with its own plan and a grid of nf::STS tiles (the last ones take the rest)
+	QSharedPointer<SpeculativeCanvas> canvas(new SpeculativeCanvas);
+	canvas->kind = kind;
+	canvas->params = params;
+	canvas->params.scaleDown = false;
+	canvas->plan = createPlan(canvas->params);
+	canvas->image = QImage(params.size, QImage::Format_RGB32);
+	canvas->pixels = reinterpret_cast<QRgb*>(canvas->image.bits());
+	canvas->columns = qMax(1, params.size.width() / nf::STS);
+	canvas->rows = qMax(1, params.size.height() / nf::STS);
+	canvas->done.fill(0, canvas->columns * canvas->rows);
+	return canvas;
+}
+
+void Speculator::createZoomCanvases()
+{
+	// Next wheel step in and out around the cursor (same weights as the wheel event)
+	const double xw = static_cast<double>(cursor_.x()) / view_.size.width();
+	const double yw = static_cast<double>(cursor_.y()) / view_.size.height();
+	for (bool in : { true, false }) {
+		Parameters params = view_;
+		params.limits.zoom(in, xw, yw);
+		canvases_.append(createCanvas(in ? CanvasZoomIn : CanvasZoomOut, params));
+	}
+}
+
+void Speculator::addVariant(const Parameters &params, QSize size, double priority)
+{
+	// Existing variant moves to the front, new ones are created there
+	SpeculativeCanvas *found = findVariant(params, size, 0);
+	for (int i = 0; found && i < variants_.count(); ++i) {
+		if (variants_[i].data() != found) continue;
+		QSharedPointer<SpeculativeCanvas> canvas = variants_.takeAt(i);
+		canvas->priority = priority;
+		variants_.prepend(canvas);
+		return;
+	}
+	Parameters variant = params;
+	variant.size = size;
+	QSharedPointer<SpeculativeCanvas> canvas = createCanvas(CanvasVariant, variant);
+	canvas->priority = priority;
+	variants_.prepend(canvas);
+}
+
+SpeculativeCanvas *Speculator::findVariant(const Parameters &params, QSize size, double tolerance) const
+{
+	// Same view and iteration cap at the given size (any if invalid), roots within tolerance and the same damping (up to rounding)
+	for (const QSharedPointer<SpeculativeCanvas> &canvas : variants_) {
+		const Parameters &variant = canvas->params;
+		if ((size.isValid() && variant.size != size) || variant.roots.count() != params.roots.count()) continue;
+		if (abs(variant.damping - params.damping) > nf::SGT * nf::SGT) continue;
+		Parameters other = params;
+		other.size = variant.size;
+		other.scaleDown = variant.scaleDown;
+		other.damping = variant.damping;
+		bool near = true;
+		for (int i = 0; i < other.roots.count() && near; ++i) {
+			near = abs(other.roots[i].value() - variant.roots[i].value()) <= tolerance;
+			other.roots[i].setValue(variant.roots[i].value());
+		}
+		if (near && !variant.paramsChanged(other)) return canvas.data();
+	}
+	return nullptr;
+}
+
+void Speculator::prefill(SpeculativeCanvas &canvas, const QVector<QSharedPointer<SpeculativeCanvas>> &sources) const
+{
+	// Copy tiles that are covered pixel by pixel by one of the sources
+	const Limits &l = canvas.params.limits;
+	const int cw = canvas.params.size.width();
+	const double hx = l.width() / (cw - 1);
+	const double hy = l.height() / (canvas.params.size.height() - 1);
+	for (const QSharedPointer<SpeculativeCanvas> &source : sources) {
+		if (!sameContent(source->params, canvas.params)) continue;
+		for (int row = 0; row < canvas.rows; ++row) {
+			for (int column = 0; column < canvas.columns; ++column) {
+				char &done = canvas.done[row * canvas.columns + column];
+				if (done) continue;
+				QRect rect = tileRect(canvas, column, row);
+				bool covered = true;
+				for (int y = rect.top(); y <= rect.bottom() && covered; ++y) {
+					covered = sample(*source, l.left() + rect.left() * hx, l.top() - y * hy, hx, hy,
+						rect.width(), true, canvas.pixels + qint64(y) * cw + rect.left());
+				}
+				done = covered;
+			}
+		}
+	}
+}
+
+bool Speculator::sample(const SpeculativeCanvas &canvas, double left, double top, double hx, double hy, int width, bool exact, QRgb *out)
+{
+	// Canvas must not be coarser, exact lookups need the same pixel grid
+	const Limits &l = canvas.params.limits;
+	const int cw = canvas.params.size.width(), ch = canvas.params.size.height();
+	const double chx = l.width() / (cw - 1), chy = l.height() / (ch - 1);
+	const double fx = (left - l.left()) / chx, fy = (l.top() - top) / chy;
+	if (chx > hx * (1 + nf::SGT) || chy > hy * (1 + nf::SGT)) return false;
+	if (exact && (chx < hx * (1 - nf::SGT) || chy < hy * (1 - nf::SGT) ||
+		qAbs(fx - qRound64(fx)) > nf::SGT || qAbs(fy - qRound64(fy)) > nf::SGT)) return false;
+
+	// Row has to be inside the canvas and its tiles done
+	const qint64 cy = qRound64(fy);
+	const qint64 cx0 = qRound64(fx);
+	const qint64 cx1 = qRound64(fx + (width - 1) * hx / chx);
+	if (cy < 0 || cy >= ch || cx0 < 0 || cx1 >= cw) return false;
+	const int row = qMin(int(cy) / nf::STS, canvas.rows - 1);
+	const int last = qMin(int(cx1) / nf::STS, canvas.columns - 1);
+	for (int column = qMin(int(cx0) / nf::STS, canvas.columns - 1); column <= last; ++column) {
+		if (!canvas.done[row * canvas.columns + column]) return false;
+	}
+
+	// Nearest pixels
+	const QRgb *line = canvas.pixels + cy * cw;
+	for (int x = 0; x < width; ++x) {
+		out[x] = line[qBound(cx0, qRound64(fx + x * hx / chx), cx1)];
+	}
+	return true;
+}
+
+bool Speculator::sameContent(const Parameters &a, const Parameters &b)
+{
+	// Everything but the view and its resolution has to match (exact lines serve basin lookup and certified frames too)
+	Parameters c = b;
+	c.limits = a.limits;
+	c.size = a.size;
+	c.scaleDown = a.scaleDown;
+	c.scaleDownFactor = a.scaleDownFactor;
+	c.frameTime = a.frameTime;
+	c.basinLookup = a.basinLookup;
+	c.certifyTiles = a.certifyTiles;
+	return !a.paramsChanged(c);
+}
+
+QRect Speculator::tileRect(const SpeculativeCanvas &canvas, int column, int row)
+{
+	// Last column / row takes the rest
+	const int x = column * nf::STS, y = row * nf::STS;
+	const int w = column == canvas.columns - 1 ? canvas.params.size.width() - x : nf::STS;
+	const int h = row == canvas.rows - 1 ? canvas.params.size.height() - y : nf::STS;
+	return QRect(x, y, w, h);
+}
+
+void Speculator::renderTile(SpeculativeTile &tile)
+{
+	// Render the rows of one tile with limits cut to the tile
+	const SpeculativeCanvas &canvas = *tile.canvas;
+	const QRect rect = tileRect(canvas, tile.column, tile.row);
+	const Limits &l = canvas.params.limits;
+	const int cw = canvas.params.size.width();
+	const double hx = l.width() / (cw - 1);
+	const double hy = l.height() / (canvas.params.size.height() - 1);
+	Parameters params = canvas.params;
+	params.limits.set(l.left() + rect.left() * hx, l.left() + rect.right() * hx, l.top() - rect.top() * hy, l.top() - rect.bottom() * hy);
+	params.size = rect.size();
+	for (int y = rect.top(); y <= rect.bottom(); ++y) {
+		ImageLine il(canvas.pixels + qint64(y) * cw + rect.left(), y, rect.width(), &params);
+		il.zy = l.top() - y * hy;
+		il.hx = hx;
+		il.plan = &canvas.plan;
+		iterateX(il);
+	}
+	*tile.done = 1;
+}
@@ -0,0 +1,87 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef SPECULATOR_H
+#define SPECULATOR_H
+
+#include "parameters.h"
+#include "kernel.h"
+#include <QSharedPointer>
+#include <QFuture>
+#include <QImage>
+
+enum CanvasKind : quint8 { CanvasPan, CanvasZoomIn, CanvasZoomOut, CanvasVariant };
+
+struct SpeculativeCanvas {
+	SpeculativeCanvas();
+	CanvasKind kind;
+	Parameters params;
+	KernelPlan plan;
+	QImage image;
+	QRgb *pixels;
+	int columns;
+	int rows;
+	QVector<char> done;
+	double priority;
+};
+
+struct SpeculativeTile {
+	SpeculativeTile();
+	SpeculativeCanvas *canvas;
+	char *done;
+	int column;
+	int row;
+	double distance;
+};
+
+// Renders tiles around the settled view while the renderer is idle: a margin of
+// nf::SPM around the view for panning and the next wheel zoom in / out level around
+// the cursor. Real requests preempt it and take every line they find in the canvases.
+// While a root is dragged or the damping is scrubbed, preview sized variants of the
+// neighboring values come first (at most nf::PVM bytes, least recently used go first).
+class Speculator
+{
+public:
+	Speculator();
+	~Speculator();
+	void prepare(const Parameters &params, const QImage &image);
+	void prepareVariants(const Parameters &params, QSize size);
+	bool setCursor(QPoint cursor);
+	void resume();
+	void preempt();
+	int lookup(const Parameters &params, QImage &image, QVector<bool> &filled);
+	const QImage *variant(const Parameters &params, QSize size);
+	void resetStats();
+	QString report() const;
+
+protected:
+	QSharedPointer<SpeculativeCanvas> createCanvas(CanvasKind kind, const Parameters &params) const;
+	void createZoomCanvases();
+	void addVariant(const Parameters &params, QSize size, double priority);
+	SpeculativeCanvas *findVariant(const Parameters &params, QSize size, double tolerance) const;
+	void prefill(SpeculativeCanvas &canvas, const QVector<QSharedPointer<SpeculativeCanvas>> &sources) const;
+	static bool sample(const SpeculativeCanvas &canvas, double left, double top, double hx, double hy, int width, bool exact, QRgb *out);
+	static bool singleEdit(const Parameters &previous, const Parameters &params, int &root);
+	static bool sameContent(const Parameters &a, const Parameters &b);
+	static QRect tileRect(const SpeculativeCanvas &canvas, int column, int row);
+	static void renderTile(SpeculativeTile &tile);
+
+private:
+	Parameters view_;
+	QPoint cursor_;
+	QVector<QSharedPointer<SpeculativeCanvas>> canvases_;
+	QVector<QSharedPointer<SpeculativeCanvas>> variants_;
+	Parameters previous_;
+	QVector<SpeculativeTile> tiles_;
+	QFuture<void> future_;
+	qint64 frames_;
+	qint64 frameHits_;
+	qint64 lines_;
+	qint64 lineHits_;
+	qint64 edits_;
+	qint64 editHits_;
+};
+
+#endif // SPECULATOR_H
@@ -0,0 +1,165 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "sweep.h"
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include <QSettings>
+
+SweepCell::SweepCell() :
+	column(0),
+	row(0),
+	nsecs(0)
+{
+}
+
+Sweep::Sweep() :
+	parameter_(SweepDamping),
+	root_(0),
+	from_(0.5, 0),
+	to_(2, 0),
+	columns_(4),
+	rows_(1),
+	cellSize_(nf::MSI, nf::MSI),
+	elapsed_(0)
+{
+}
+
+bool Sweep::load(const QString &file, QString *error)
+{
+	// Base parameters are stored like exported settings
+	QSettings ini(file, QSettings::IniFormat);
+	Parameters base;
+	base.load(ini);
+
+	// Sweep settings
+	ini.beginGroup("Sweep");
+	parameter_ = ini.value("parameter", "damping").toString().toLower() == "root" ? SweepRoot : SweepDamping;
+	root_ = ini.value("root", 0).toInt();
+	from_ = string2complex(ini.value("from", complex2string(from_)).toString());
+	to_ = string2complex(ini.value("to", complex2string(to_)).toString());
+	columns_ = ini.value("columns", columns_).toInt();
+	rows_ = ini.value("rows", rows_).toInt();
+	cellSize_ = ini.value("cellSize", cellSize_).toSize();
+	ini.endGroup();
+
+	// Check settings
+	QString message;
+	if (base.roots.count() < 2) message = "No roots found";
+	else if (parameter_ == SweepRoot && (root_ < 0 || root_ >= base.roots.count())) message = "Invalid root index";
+	else if (columns_ < 1 || rows_ < 1) message = "Invalid number of columns or rows";
+	else if (cellSize_.width() < 2 || cellSize_.height() < 2) message = "Invalid cell size";
+	if (error != nullptr) *error = message;
+	if (!message.isEmpty()) return false;
+	expand(base);
+	return true;
+}
+
+void Sweep::expand(const Parameters &base)
+{
+	// Keep view height and center, fit width to cell aspect ratio
+	const Limits &l = base.limits;
+	double h = l.height();
+	double w = h * (cellSize_.width() - 1) / (cellSize_.height() - 1);
+	complex center(0.5 * (l.left() + l.right()), 0.5 * (l.top() + l.bottom()));
+	Parameters params = base;
+	params.size = cellSize_;
+	params.scaleDown = false;
+	params.orbitMode = false;
+	params.limits.set(center.real() - 0.5 * w, center.real() + 0.5 * w, center.imag() + 0.5 * h, center.imag() - 0.5 * h);
+
+	// Damping runs through all cells row by row, roots move over a lattice
+	cells_.clear();
+	const int count = columns_ * rows_;
+	for (int row = 0; row < rows_; ++row) {
+		for (int column = 0; column < columns_; ++column) {
+			SweepCell cell;
+			cell.column = column;
+			cell.row = row;
+			if (parameter_ == SweepDamping) {
+				double u = count > 1 ? (row * columns_ + column) / (count - 1.0) : 0;
+				cell.value = from_ + u * (to_ - from_);
+				params.damping = cell.value;
+			} else {
+				double u = columns_ > 1 ? column / (columns_ - 1.0) : 0;
+				double v = rows_ > 1 ? row / (rows_ - 1.0) : 0;
+				cell.value = complex(from_.real() + u * (to_.real() - from_.real()), from_.imag() + v * (to_.imag() - from_.imag()));
+				params.roots[root_].setValue(cell.value);
+			}
+			cell.params = params;
+			cells_.append(cell);
+		}
+	}
+}
+
+QImage Sweep::render()
+{
+	// Contact sheet with one pixel gaps between cells
+	QElapsedTimer timer;
+	timer.start();
+	const int cw = cellSize_.width(), ch = cellSize_.height();
+	QImage sheet(columns_ * (cw + 1) - 1, rows_ * (ch + 1) - 1, QImage::Format_RGB32);
+	sheet.fill(Qt::gray);
+
+	// Cells differ in damping or one root only -> share one palette, the rest of the plan per cell
+	const QVector<QRgb> palette = createPalette(cells_.first().params);
+
+	// Lines of all cells write directly into the sheet
+	QVector<ImageLine> lines;
+	lines.reserve(cells_.count() * ch);
+	for (SweepCell &cell : cells_) {
+		const Parameters &params = cell.params;
+		const double xFactor = params.limits.width() / (cw - 1);
+		const double yFactor = -params.limits.height() / (ch - 1);
+		const int x0 = cell.column * (cw + 1), y0 = cell.row * (ch + 1);
+		cell.plan = createPlan(params, palette);
+		for (int y = 0; y < ch; ++y) {
+			ImageLine il((QRgb*)(sheet.scanLine(y0 + y)) + x0, y, cw, &params);
+			il.zy = y * yFactor + params.limits.top();
+			il.hx = xFactor;
+			il.plan = &cell.plan;
+			lines.append(il);
+		}
+	}
+
+	// Render everything as one batch on the thread pool, timing each line
+	QVector<qint64> nsecs(lines.count());
+	const ImageLine *first = lines.constData();
+	QtConcurrent::blockingMap(lines, [first, &nsecs](ImageLine &il) {
+		QElapsedTimer lineTimer;
+		lineTimer.start();
+		iterateX(il);
+		nsecs[&il - first] = lineTimer.nsecsElapsed();
+	});
+
+	// Sum up line times per cell
+	for (int i = 0; i < cells_.count(); ++i) {
+		cells_[i].nsecs = 0;
+		for (int y = 0; y < ch; ++y) cells_[i].nsecs += nsecs[i * ch + y];
+	}
+	elapsed_ = timer.elapsed();
+	return sheet;
+}
+
+QString Sweep::report() const
+{
+	// Static output strings
+	static const QString header = "column,row,%1,ms\n";
+	static const QString line = "%1,%2,%3,%4\n";
+	static const QString footer = "# %1 cells of %2x%3 in %4 ms\n";
+
+	// One line per cell
+	QString out = header.arg(parameter_ == SweepDamping ? "damping" : "root" + QString::number(root_));
+	for (const SweepCell &cell : cells_) {
+		out += line.arg(cell.column).arg(cell.row).arg(complex2string(cell.value, 4)).arg(cell.nsecs / 1e6, 0, 'f', 2);
+	}
+	return out + footer.arg(cells_.count()).arg(cellSize_.width()).arg(cellSize_.height()).arg(elapsed_);
+}
+
+const QVector<SweepCell> &Sweep::cells() const
+{
+	// Return expanded cells
+	return cells_;
+}
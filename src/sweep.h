@@ -0,0 +1,49 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "parameters.h"
+#include "kernel.h"
+#include <QImage>
+#include <QString>
+
+enum SweepParameter : quint8 { SweepDamping, SweepRoot };
+
+struct SweepCell {
+	SweepCell();
+	int column;
+	int row;
+	complex value;
+	Parameters params;
+	KernelPlan plan;
+	qint64 nsecs;
+};
+
+class Sweep
+{
+public:
+	Sweep();
+	bool load(const QString &file, QString *error = nullptr);
+	QImage render();
+	QString report() const;
+	const QVector<SweepCell> &cells() const;
+
+private:
+	void expand(const Parameters &base);
+
+	SweepParameter parameter_;
+	int root_;
+	complex from_;
+	complex to_;
+	int columns_;
+	int rows_;
+	QSize cellSize_;
+	QVector<SweepCell> cells_;
+	qint64 elapsed_;
+};
+
+#endif // SWEEP_H
@@ -0,0 +1,176 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "symmetry.h"
+#include <QtConcurrent>
+#include <cmath>
+
+SymmetryMap::SymmetryMap() :
+	valid(false)
+{
+}
+
+Symmetry::Symmetry() :
+	rowKind_(MirrorRows),
+	rows_(false),
+	columns_(false),
+	rowAxis_(0),
+	columnAxis_(0),
+	left_(0),
+	right_(-1)
+{
+	// No symmetry -> everything is rendered
+}
+
+Symmetry::Symmetry(const Parameters &params, const KernelPlan &plan, QSize size) :
+	Symmetry()
+{
+	// Every symmetry of the root set keeps its center
+	const int width = size.width(), height = size.height();
+	right_ = width - 1;
+	if (plan.large || plan.roots.isEmpty() || width < 2 || height < 2) return;
+	complex center(0, 0);
+	for (const fcomplex &root : plan.roots) center += complex(root.real(), root.imag());
+	center /= plan.roots.count();
+
+	// Mirror axes in pixels (twice the index of the center), usable if on the pixel grid
+	const Limits &l = params.limits;
+	const double columnAxis = 2 * (center.real() - l.left()) * (width - 1) / l.width();
+	const double rowAxis = 2 * (l.top() - center.imag()) * (height - 1) / l.height();
+	columnAxis_ = qRound(columnAxis);
+	rowAxis_ = qRound(rowAxis);
+	const bool columnGrid = fabs(columnAxis - columnAxis_) < nf::SYP && columnAxis_ >= 0 && columnAxis_ <= 2 * (width - 1);
+	const bool rowGrid = fabs(rowAxis - rowAxis_) < nf::SYP && rowAxis_ >= 0 && rowAxis_ <= 2 * (height - 1);
+
+	// Mirrors need real damping, the rotation maps whole rows only in a horizontally centered view
+	const bool real = params.damping.imag() == 0;
+	if (real && rowGrid) maps_[MirrorRows] = createMap(plan, params, MirrorRows, center);
+	if (real && columnGrid) maps_[MirrorColumns] = createMap(plan, params, MirrorColumns, center);
+	if (!maps_[MirrorRows].valid && rowGrid && columnGrid && columnAxis_ == width - 1)
+		maps_[PointRotation] = createMap(plan, params, PointRotation, center);
+	rows_ = maps_[MirrorRows].valid || maps_[PointRotation].valid;
+	rowKind_ = maps_[MirrorRows].valid ? MirrorRows : PointRotation;
+	columns_ = maps_[MirrorColumns].valid;
+
+	// Rendered columns: the half of the overlap with its mirror image and everything outside
+	if (columns_ && columnAxis_ >= width - 1) right_ = columnAxis_ / 2;
+	else if (columns_) left_ = (columnAxis_ + 1) / 2;
+}
+
+bool Symmetry::isEmpty() const
+{
+	// Nothing to map
+	return !rows_ && !columns_;
+}
+
+int Symmetry::left() const
+{
+	// First rendered column
+	return left_;
+}
+
+int Symmetry::right() const
+{
+	// Last rendered column
+	return right_;
+}
+
+void Symmetry::markRows(QVector<bool> &filled) const
+{
+	// Mapped rows are not rendered
+	if (!rows_) return;
+	for (int y = 0; y < filled.count(); ++y) {
+		if (derived(y, rowAxis_, filled.count())) filled[y] = true;
+	}
+}
+
+void Symmetry::apply(QImage &image, const Parameters &params, const KernelPlan &plan) const
+{
+	// Rendered rows first get their mirrored columns, then whole rows are mapped
+	if (isEmpty()) return;
+	const int width = image.width(), height = image.height();
+	const Limits &l = params.limits;
+	const double hx = l.width() / (width - 1), hy = l.height() / (height - 1);
+	QRgb *pixels = reinterpret_cast<QRgb*>(image.bits());
+	QVector<int> rows(height);
+	for (int y = 0; y < height; ++y) rows[y] = y;
+
+	// Mapped colors of src for the pixels from..to of row y, ambiguous ones (0) are rendered
+	auto map = [&](const SymmetryMap &m, int y, int from, int to, const QRgb *src, int step) {
+		QRgb *line = pixels + qint64(y) * width;
+		QRgb color = 0, mapped = 0;
+		for (int x = from; x <= to; ++x, src += step) {
+			if (*src != color) {
+				color = *src;
+				mapped = m.colors.value(color, 0);
+			}
+			line[x] = mapped != 0 ? mapped : iteratePoint(fcomplex(l.left() + x * hx, l.top() - y * hy), &params, plan);
+		}
+	};
+	if (columns_) {
+		const int from = left_ > 0 ? 0 : right_ + 1;
+		const int to = left_ > 0 ? left_ - 1 : qMin(columnAxis_, width - 1);
+		QtConcurrent::blockingMap(rows, [&](int &y) {
+			if (rows_ && derived(y, rowAxis_, height)) return;
+			map(maps_[MirrorColumns], y, from, to, pixels + qint64(y) * width + columnAxis_ - from, -1);
+		});
+	}
+	if (rows_) {
+		const bool rotation = rowKind_ == PointRotation;
+		QtConcurrent::blockingMap(rows, [&](int &y) {
+			if (!derived(y, rowAxis_, height)) return;
+			const QRgb *source = pixels + qint64(rowAxis_ - y) * width;
+			map(maps_[rowKind_], y, 0, width - 1, rotation ? source + width - 1 : source, rotation ? -1 : 1);
+		});
+	}
+}
+
+QVector<int> Symmetry::permutation(const KernelPlan &plan, SymmetryKind kind, complex center)
+{
+	// Root every root is mapped to, empty if one of them has no partner
+	const int count = plan.roots.count();
+	QVector<int> roots(count, -1);
+	for (int r = 0; r < count; ++r) {
+		double x = plan.roots[r].real(), y = plan.roots[r].imag();
+		if (kind != MirrorRows) x = 2 * center.real() - x;
+		if (kind != MirrorColumns) y = 2 * center.imag() - y;
+		for (int s = 0; s < count && roots[r] < 0; ++s) {
+			const double dx = plan.roots[s].real() - x, dy = plan.roots[s].imag() - y;
+			if (dx * dx + dy * dy < nf::SYE * nf::SYE) roots[r] = s;
+		}
+		if (roots[r] < 0) return QVector<int>();
+	}
+	return roots;
+}
+
+SymmetryMap Symmetry::createMap(const KernelPlan &plan, const Parameters &params, SymmetryKind kind, complex center)
+{
+	// Shade of a root -> same shade of the mapped root, cycles and holes stay
+	SymmetryMap map;
+	const QVector<int> roots = permutation(plan, kind, center);
+	if (roots.isEmpty()) return map;
+	map.valid = true;
+	map.colors.insert(qRgb(0, 0, 0), qRgb(0, 0, 0));
+	map.colors.insert(nf::NCC.rgb(), nf::NCC.rgb());
+	const quint16 maxIterations = params.maxIterations;
+	for (int r = 0; r < roots.count(); ++r) {
+		for (quint16 i = 0; i < maxIterations; ++i) {
+			const QRgb key = plan.palette[r * maxIterations + i];
+			const QRgb value = plan.palette[roots[r] * maxIterations + i];
+
+			// Same shade, different mapped shades -> ambiguous
+			if (!map.colors.contains(key)) map.colors.insert(key, value);
+			else if (map.colors.value(key) != value) map.colors.insert(key, 0);
+		}
+	}
+	return map;
+}
+
+bool Symmetry::derived(int i, int axis, int count)
+{
+	// Mapped from axis - i: the upper half of the overlap with the mirror image if it ends at the border, else the lower one
+	if (axis >= count - 1) return 2 * i > axis && i <= axis;
+	return 2 * i < axis;
+}
@@ -0,0 +1,55 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include "parameters.h"
+#include "kernel.h"
+#include <QHash>
+#include <QImage>
+
+enum SymmetryKind : quint8 { MirrorRows, MirrorColumns, PointRotation };
+
+struct SymmetryMap {
+	SymmetryMap();
+	bool valid;
+	QHash<QRgb, QRgb> colors;
+};
+
+// Symmetries of the root set around its center that map pixels onto pixels: the mirror
+// on the horizontal and vertical axis (real damping only) and the rotation by 180 degrees
+// (every even n-fold rotation). Only the fundamental domain is rendered, the rest is
+// copied with the colors of the mapped roots. Rows and columns whose image is off the
+// pixel grid or outside the view are rendered, so are pixels with an ambiguous color.
+// The large degree engine is left out (its far-field error is not symmetric).
+class Symmetry
+{
+public:
+	Symmetry();
+	Symmetry(const Parameters &params, const KernelPlan &plan, QSize size);
+	bool isEmpty() const;
+	int left() const;
+	int right() const;
+	void markRows(QVector<bool> &filled) const;
+	void apply(QImage &image, const Parameters &params, const KernelPlan &plan) const;
+
+protected:
+	static QVector<int> permutation(const KernelPlan &plan, SymmetryKind kind, complex center);
+	static SymmetryMap createMap(const KernelPlan &plan, const Parameters &params, SymmetryKind kind, complex center);
+	static bool derived(int i, int axis, int count);
+
+private:
+	SymmetryMap maps_[3];
+	SymmetryKind rowKind_;
+	bool rows_;
+	bool columns_;
+	int rowAxis_;
+	int columnAxis_;
+	int left_;
+	int right_;
+};
+
+#endif // SYMMETRY_H
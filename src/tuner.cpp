@@ -0,0 +1,70 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "tuner.h"
+#include <QString>
+#include <cmath>
+
+IterationTuner::IterationTuner() :
+	cap_(0),
+	limit_(0)
+{
+	// Nothing measured yet
+	resetStats();
+}
+
+quint16 IterationTuner::iterations(const Parameters &params)
+{
+	// Start at the limit whenever it changes
+	if (!params.autoIterations) return params.maxIterations;
+	if (limit_ != params.maxIterations) {
+		limit_ = params.maxIterations;
+		cap_ = limit_;
+	}
+	return qBound(qMin(nf::AIM, limit_), quint16(ceil(cap_)), limit_);
+}
+
+void IterationTuner::measure(const Parameters &params, quint16 cap, const KernelStats &stats)
+{
+	// Only frames rendered with the tuned cap (previews may have been capped further)
+	if (!params.autoIterations || cap != iterations(params)) return;
+
+	// Pixels that ran into the cap did not converge (yet), cycles and escapes never will
+	qint64 converged = 0;
+	for (int b = 0; b < nf::HGB; ++b) converged += stats.histogram[b];
+	const qint64 total = converged + stats.capped;
+	if (total == 0) return;
+
+	// Too many holes -> double, else the first bucket that reaches the fraction
+	double target = 2.0 * cap;
+	if (stats.capped <= (1 - nf::AIT) * total) {
+		qint64 sum = 0;
+		int b = 0;
+		while (b < nf::HGB - 1 && (sum += stats.histogram[b]) < nf::AIT * total) ++b;
+		target = ceil((b + 1) * double(cap) / nf::HGB);
+	}
+	cap_ = target > cap_ ? target : cap_ + nf::AIS * (target - cap_);
+	cap_ = qBound(double(qMin(nf::AIM, limit_)), cap_, double(limit_));
+
+	// Upper bound: pixels stopped by the cap would have run up to the limit (some converge earlier)
+	iterations_ += stats.iterations;
+	saved_ += stats.capped * (limit_ - cap);
+}
+
+void IterationTuner::resetStats()
+{
+	// Reset counters
+	iterations_ = saved_ = 0;
+}
+
+QString IterationTuner::report() const
+{
+	// Static output string
+	static const QString out = "Auto iterations: cap %1 of %2, at most %3 % of the iterations saved (capped pixels counted up to the limit)";
+
+	// Savings relative to rendering with the limit (upper bound)
+	return out.arg(qRound(cap_)).arg(limit_)
+		.arg(100.0 * saved_ / qMax(qint64(1), iterations_ + saved_), 0, 'f', 1);
+}
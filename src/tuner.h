@@ -0,0 +1,31 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef TUNER_H
+#define TUNER_H
+
+#include "parameters.h"
+#include "imageline.h"
+
+// Automatic iteration cap: the histogram of iterations to converge of every frame tells
+// the smallest cap that still converges nf::AIT of the pixels. More pixels running into
+// the cap double it at once, lower caps are approached smoothly. maxIterations is the limit.
+class IterationTuner
+{
+public:
+	IterationTuner();
+	quint16 iterations(const Parameters &params);
+	void measure(const Parameters &params, quint16 cap, const KernelStats &stats);
+	void resetStats();
+	QString report() const;
+
+private:
+	double cap_;
+	quint16 limit_;
+	qint64 iterations_;
+	qint64 saved_;
+};
+
+#endif // TUNER_H
@@ -0,0 +1,229 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#include "zoomvideo.h"
+#include "framewriter.h"
+#include "renderer.h"
+#include "kernel.h"
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include <cmath>
+
+static inline void addBilinear(double *rgb, const QRgb *pixels, int width, int height, double x, double y, bool wrap)
+{
+	// Clamp or wrap coordinates
+	y = qBound(0.0, y, height - 1.0);
+	if (wrap) {
+		x = fmod(x, width);
+		if (x < 0) x += width;
+	} else x = qBound(0.0, x, width - 1.0);
+
+	// Get the four neighbours
+	int x0 = static_cast<int>(x);
+	int y0 = static_cast<int>(y);
+	int x1 = wrap ? (x0 + 1) % width : qMin(x0 + 1, width - 1);
+	int y1 = qMin(y0 + 1, height - 1);
+	double fx = x - x0;
+	double fy = y - y0;
+	QRgb p00 = pixels[qint64(y0) * width + x0];
+	QRgb p01 = pixels[qint64(y0) * width + x1];
+	QRgb p10 = pixels[qint64(y1) * width + x0];
+	QRgb p11 = pixels[qint64(y1) * width + x1];
+
+	// Weighted sum per channel
+	double w00 = (1 - fx) * (1 - fy), w01 = fx * (1 - fy), w10 = (1 - fx) * fy, w11 = fx * fy;
+	rgb[0] += w00 * qRed(p00) + w01 * qRed(p01) + w10 * qRed(p10) + w11 * qRed(p11);
+	rgb[1] += w00 * qGreen(p00) + w01 * qGreen(p01) + w10 * qGreen(p10) + w11 * qGreen(p11);
+	rgb[2] += w00 * qBlue(p00) + w01 * qBlue(p01) + w10 * qBlue(p10) + w11 * qBlue(p11);
+}
+
+ZoomVideo::ZoomVideo(const Parameters &params, QSize size, int frameCount, double zoom, QObject *parent) :
+	QObject(parent),
+	params_(params),
+	size_(size),
+	frameCount_(qMax(2, frameCount)),
+	zoom_(qMax(1.0, zoom)),
+	stripWidth_(0),
+	stripHeight_(0),
+	rhoMax_(0),
+	rhoStep_(1),
+	renderedPixels_(0),
+	elapsed_(0)
+{
+	// Zoom into the center of the given view
+	const Limits &l = params.limits;
+	center_ = complex(0.5 * (l.left() + l.right()), 0.5 * (l.top() + l.bottom()));
+	params_.scaleDown = false;
+	params_.orbitMode = false;
+}
+
+bool ZoomVideo::render(const QString &output, int fps, ZoomMethod method, double oversample)
+{
+	// Render keyframes or log-polar strip
+	QElapsedTimer timer;
+	timer.start();
+	renderedPixels_ = 0;
+	if (method == ZoomKeyframes) {
+		renderKeyframes(oversample);
+	} else if (!renderStrip(oversample)) {
+		return false;
+	}
+
+	// Open output
+	FrameWriter writer;
+	if (!writer.open(output, size_, fps)) {
+		error_ = writer.errorString();
+		return false;
+	}
+
+	// Synthesize all frames by resampling
+	QImage image(size_, QImage::Format_RGB32);
+	for (int f = 0; f < frameCount_; ++f) {
+		if (method == ZoomKeyframes) synthesizeFromKeyframes(f, image);
+		else synthesizeFromStrip(f, image);
+		if (!writer.write(image)) {
+			error_ = writer.errorString();
+			return false;
+		}
+		emit progress("Frames", f + 1, frameCount_);
+	}
+	writer.close();
+	elapsed_ = timer.elapsed();
+	return true;
+}
+
+QString ZoomVideo::errorString() const
+{
+	// Return last error
+	return error_;
+}
+
+QString ZoomVideo::report() const
+{
+	// Static output string
+	static const QString out = "Rendered %1 pixels for %2 frames instead of %3 (%4x less compute) in %5 s";
+
+	// Compare with rendering every frame
+	qint64 naive = qint64(frameCount_) * size_.width() * size_.height();
+	return out.arg(renderedPixels_).arg(frameCount_).arg(naive)
+		.arg(static_cast<double>(naive) / qMax(qint64(1), renderedPixels_), 0, 'f', 1)
+		.arg(elapsed_ / 1000.0, 0, 'f', 1);
+}
+
+double ZoomVideo::frameZoom(int frame) const
+{
+	// Constant zoom speed from 1 to zoom_
+	return pow(zoom_, static_cast<double>(frame) / (frameCount_ - 1));
+}
+
+double ZoomVideo::pixelSize(double zoom) const
+{
+	// Complex distance between two output pixels
+	return params_.limits.height() / zoom / (size_.height() - 1);
+}
+
+void ZoomVideo::renderKeyframes(double oversample)
+{
+	// Keyframe k shows the view zoomed by 2^k at the oversampled size
+	int count = static_cast<int>(floor(log2(zoom_))) + 1;
+	Parameters params = params_;
+	params.size = QSize(ceil(oversample * size_.width()), ceil(oversample * size_.height()));
+	keyframes_.clear();
+	for (int k = 0; k < count; ++k) {
+		double h = params_.limits.height() / pow(2.0, k);
+		double w = h * (params.size.width() - 1) / (params.size.height() - 1);
+		params.limits.set(center_.real() - 0.5 * w, center_.real() + 0.5 * w, center_.imag() + 0.5 * h, center_.imag() - 0.5 * h);
+		keyframes_.append(Renderer::renderImage(params, true));
+		renderedPixels_ += qint64(params.size.width()) * params.size.height();
+		emit progress("Keyframes", k + 1, count);
+	}
+}
+
+bool ZoomVideo::renderStrip(double oversample)
+{
+	// One pixel per output pixel on the outer radius, square in (angle, log radius)
+	double radius = 0.5 * sqrt(double(size_.width()) * size_.width() + double(size_.height()) * size_.height());
+	stripWidth_ = ceil(2 * nf::PI * radius * oversample);
+	rhoStep_ = 2 * nf::PI / stripWidth_;
+	rhoMax_ = log(1.01 * radius * pixelSize(1));
+	double rhoMin = log(0.5 * pixelSize(zoom_));
+	stripHeight_ = ceil((rhoMax_ - rhoMin) / rhoStep_) + 2;
+
+	// Check memory
+	if (qint64(stripWidth_) * stripHeight_ > nf::MSP) {
+		error_ = QString("Exp-map strip of %1 x %2 pixels is too large").arg(stripWidth_).arg(stripHeight_);
+		return false;
+	}
+
+	// Render rows in chunks to report progress
+	strip_.resize(stripWidth_ * stripHeight_);
+	const KernelPlan plan = createPlan(params_);
+	const int chunk = 64;
+	for (int y0 = 0; y0 < stripHeight_; y0 += chunk) {
+		QVector<int> rows;
+		for (int y = y0; y < qMin(y0 + chunk, stripHeight_); ++y) rows.append(y);
+		QtConcurrent::blockingMap(rows, [this, &plan](int &y) {
+			double r = exp(rhoMax_ - y * rhoStep_);
+			QRgb *row = strip_.data() + qint64(y) * stripWidth_;
+			for (int x = 0; x < stripWidth_; ++x) {
+				fcomplex z = center_ + std::polar(r, x * rhoStep_);
+				row[x] = iteratePoint(z, &params_, plan);
+			}
+		});
+		emit progress("Exp-map strip", qMin(y0 + chunk, stripHeight_), stripHeight_);
+	}
+	renderedPixels_ = qint64(stripWidth_) * stripHeight_;
+	return true;
+}
+
+void ZoomVideo::synthesizeFromKeyframes(int frame, QImage &image) const
+{
+	// Select keyframe that covers the frame -> scale ratio in [1, 2)
+	double zoom = frameZoom(frame);
+	int k = qBound(0, static_cast<int>(floor(log2(zoom))), keyframes_.count() - 1);
+	const QImage &key = keyframes_[k];
+	const QRgb *src = reinterpret_cast<const QRgb*>(key.constBits());
+	const int kw = key.width(), kh = key.height();
+	const double scale = (kh - 1.0) / ((size_.height() - 1.0) * zoom / pow(2.0, k));
+	const double kx = 0.5 * (kw - 1), ky = 0.5 * (kh - 1);
+	const double ox = 0.5 * (size_.width() - 1), oy = 0.5 * (size_.height() - 1);
+
+	// Resample with 2x2 bilinear taps per pixel
+	QRgb *dst = reinterpret_cast<QRgb*>(image.bits());
+	QVector<int> rows(size_.height());
+	for (int y = 0; y < rows.count(); ++y) rows[y] = y;
+	QtConcurrent::blockingMap(rows, [&](int &y) {
+		for (int x = 0; x < size_.width(); ++x) {
+			double rgb[3] = { 0, 0, 0 };
+			for (double d : { -0.25, 0.25 }) {
+				for (double e : { -0.25, 0.25 }) {
+					addBilinear(rgb, src, kw, kh, kx + (x + d - ox) * scale, ky + (y + e - oy) * scale, false);
+				}
+			}
+			dst[qint64(y) * size_.width() + x] = qRgb(rgb[0] / 4 + 0.5, rgb[1] / 4 + 0.5, rgb[2] / 4 + 0.5);
+		}
+	});
+}
+
+void ZoomVideo::synthesizeFromStrip(int frame, QImage &image) const
+{
+	// Map every pixel to (angle, log radius)
+	const double pw = pixelSize(frameZoom(frame));
+	const double ox = 0.5 * (size_.width() - 1), oy = 0.5 * (size_.height() - 1);
+	QRgb *dst = reinterpret_cast<QRgb*>(image.bits());
+	QVector<int> rows(size_.height());
+	for (int y = 0; y < rows.count(); ++y) rows[y] = y;
+	QtConcurrent::blockingMap(rows, [&](int &y) {
+		for (int x = 0; x < size_.width(); ++x) {
+			double wx = (x - ox) * pw;
+			double wy = (oy - y) * pw;
+			double rho = 0.5 * log(wx * wx + wy * wy);
+			double rgb[3] = { 0, 0, 0 };
+			addBilinear(rgb, strip_.constData(), stripWidth_, stripHeight_,
+				atan2(wy, wx) / rhoStep_, (rhoMax_ - rho) / rhoStep_, true);
+			dst[qint64(y) * size_.width() + x] = qRgb(rgb[0] + 0.5, rgb[1] + 0.5, rgb[2] + 0.5);
+		}
+	});
+}
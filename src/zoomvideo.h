@@ -0,0 +1,53 @@
+// This file is part of the NewtonFractal project.
+// Copyright (C) 2019 Christian Bauer and Timon Foehl
+// License: GNU General Public License version 3 or later,
+// see the file LICENSE in the main directory.
+
+#ifndef ZOOMVIDEO_H
+#define ZOOMVIDEO_H
+
+#include "parameters.h"
+#include <QImage>
+#include <QObject>
+
+enum ZoomMethod : quint8 { ZoomKeyframes, ZoomExpMap };
+
+class ZoomVideo : public QObject
+{
+	Q_OBJECT
+
+public:
+	ZoomVideo(const Parameters &params, QSize size, int frameCount, double zoom, QObject *parent = nullptr);
+	bool render(const QString &output, int fps, ZoomMethod method, double oversample);
+	QString errorString() const;
+	QString report() const;
+
+protected:
+	double frameZoom(int frame) const;
+	double pixelSize(double zoom) const;
+	void renderKeyframes(double oversample);
+	bool renderStrip(double oversample);
+	void synthesizeFromKeyframes(int frame, QImage &image) const;
+	void synthesizeFromStrip(int frame, QImage &image) const;
+
+signals:
+	void progress(const QString &stage, int done, int total);
+
+private:
+	Parameters params_;
+	QSize size_;
+	int frameCount_;
+	double zoom_;
+	complex center_;
+	QVector<QImage> keyframes_;
+	QVector<QRgb> strip_;
+	int stripWidth_;
+	int stripHeight_;
+	double rhoMax_;
+	double rhoStep_;
+	qint64 renderedPixels_;
+	qint64 elapsed_;
+	QString error_;
+};
+
+#endif // ZOOMVIDEO_H